@@ -0,0 +1,92 @@
+// Copyright 2016 Husky Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/binstream_pool.hpp"
+
+#include <utility>
+#include <vector>
+
+namespace husky {
+namespace base {
+
+const size_t BinStreamPool::kMinPooledBytes = 4096;
+const size_t BinStreamPool::kMaxPooledBytes = 64 << 20;
+const size_t BinStreamPool::kMaxBuffersPerClass = 16;
+const size_t BinStreamPool::kMaxBytesPerThread = 256 << 20;
+
+BinStreamPool::BinStreamPool() : buffers_(size_class(kMaxPooledBytes) + 1) {}
+
+BinStreamPool& BinStreamPool::get() {
+    static thread_local BinStreamPool pool;
+    return pool;
+}
+
+int BinStreamPool::size_class(size_t capacity) {
+    int k = 0;
+    while (capacity >>= 1)
+        ++k;
+    return k;
+}
+
+std::vector<char> BinStreamPool::acquire(size_t capacity) {
+    if (capacity >= kMinPooledBytes && capacity <= kMaxPooledBytes) {
+        // Buffers in the class above always fit, and those in the class of `capacity` may fit.
+        // Larger ones are left for larger requests.
+        int k = size_class(capacity);
+        for (int c = k + 1; c >= k; --c) {
+            if (c >= static_cast<int>(buffers_.size()))
+                continue;
+            auto& bucket = buffers_[c];
+            for (size_t i = bucket.size(); i-- > 0;) {
+                if (bucket[i].capacity() < capacity)
+                    continue;
+                std::vector<char> buffer(std::move(bucket[i]));
+                if (i + 1 != bucket.size())
+                    bucket[i] = std::move(bucket.back());
+                bucket.pop_back();
+                --num_buffers_;
+                pooled_bytes_ -= buffer.capacity();
+                return buffer;
+            }
+        }
+    }
+    std::vector<char> buffer;
+    buffer.reserve(capacity);
+    return buffer;
+}
+
+void BinStreamPool::release(std::vector<char>&& buffer) {
+    std::vector<char> owned(std::move(buffer));
+    size_t capacity = owned.capacity();
+    if (capacity < kMinPooledBytes || capacity > kMaxPooledBytes || pooled_bytes_ + capacity > kMaxBytesPerThread)
+        return;
+    auto& bucket = buffers_[size_class(capacity)];
+    if (bucket.size() >= kMaxBuffersPerClass)
+        return;
+    owned.clear();
+    bucket.push_back(std::move(owned));
+    ++num_buffers_;
+    pooled_bytes_ += capacity;
+}
+
+void BinStreamPool::clear() {
+    for (auto& bucket : buffers_)
+        std::vector<std::vector<char>>().swap(bucket);
+    num_buffers_ = 0;
+    pooled_bytes_ = 0;
+}
+
+}  // namespace base
+}  // namespace husky
@@ -0,0 +1,61 @@
+// Copyright 2016 Husky Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace husky {
+namespace base {
+
+/// A per-thread pool of BinStream buffers, in power-of-two size classes.
+///
+/// Buffers which are given back by BinStream::recycle() are reused by BinStream::reserve(), so that the
+/// buffers of channels do not have to be grown from scratch by reallocation in every superstep.
+/// Buffers smaller than kMinPooledBytes or larger than kMaxPooledBytes are not pooled, and a thread
+/// holds at most kMaxBytesPerThread bytes in its pool.
+class BinStreamPool {
+   public:
+    /// The pool of the calling thread
+    static BinStreamPool& get();
+
+    /// Return an empty buffer whose capacity is at least `capacity`
+    std::vector<char> acquire(size_t capacity);
+    /// Keep the buffer for later acquire() if there is room. `buffer` is left empty in any case.
+    void release(std::vector<char>&& buffer);
+    void clear();
+
+    inline size_t get_num_buffers() const { return num_buffers_; }
+    inline size_t get_pooled_bytes() const { return pooled_bytes_; }
+
+    static const size_t kMinPooledBytes;
+    static const size_t kMaxPooledBytes;
+    static const size_t kMaxBuffersPerClass;
+    static const size_t kMaxBytesPerThread;
+
+   protected:
+    BinStreamPool();
+
+    // The size class holding buffers with capacity in [2^k, 2^(k+1))
+    static int size_class(size_t capacity);
+
+    std::vector<std::vector<std::vector<char>>> buffers_;
+    size_t num_buffers_ = 0;
+    size_t pooled_bytes_ = 0;
+};
+
+}  // namespace base
+}  // namespace husky
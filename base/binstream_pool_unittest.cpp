@@ -0,0 +1,89 @@
+#include "base/binstream_pool.hpp"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "base/serialization.hpp"
+
+namespace husky {
+namespace {
+
+using base::BinStream;
+using base::BinStreamPool;
+
+class TestBinStreamPool : public testing::Test {
+   public:
+    TestBinStreamPool() {}
+    ~TestBinStreamPool() {}
+
+   protected:
+    void SetUp() { BinStreamPool::get().clear(); }
+    void TearDown() { BinStreamPool::get().clear(); }
+};
+
+TEST_F(TestBinStreamPool, AcquireAndRelease) {
+    auto& pool = BinStreamPool::get();
+    std::vector<char> buffer = pool.acquire(10000);
+    EXPECT_GE(buffer.capacity(), 10000);
+    EXPECT_EQ(pool.get_num_buffers(), 0);
+
+    buffer.resize(100);
+    const char* data = buffer.data();
+    size_t capacity = buffer.capacity();
+    pool.release(std::move(buffer));
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(pool.get_num_buffers(), 1);
+    EXPECT_EQ(pool.get_pooled_bytes(), capacity);
+
+    // Too large for the pooled buffer
+    std::vector<char> larger = pool.acquire(capacity + 1);
+    EXPECT_NE(larger.data(), data);
+    EXPECT_EQ(pool.get_num_buffers(), 1);
+
+    std::vector<char> reused = pool.acquire(capacity - 100);
+    EXPECT_EQ(reused.data(), data);
+    EXPECT_TRUE(reused.empty());
+    EXPECT_EQ(pool.get_num_buffers(), 0);
+    EXPECT_EQ(pool.get_pooled_bytes(), 0);
+}
+
+TEST_F(TestBinStreamPool, Limits) {
+    auto& pool = BinStreamPool::get();
+    pool.release(std::vector<char>(BinStreamPool::kMinPooledBytes - 1));
+    pool.release(std::vector<char>(BinStreamPool::kMaxPooledBytes + 1));
+    EXPECT_EQ(pool.get_num_buffers(), 0);
+
+    for (int i = 0; i < BinStreamPool::kMaxBuffersPerClass + 1; ++i)
+        pool.release(std::vector<char>(BinStreamPool::kMinPooledBytes));
+    EXPECT_EQ(pool.get_num_buffers(), BinStreamPool::kMaxBuffersPerClass);
+}
+
+TEST_F(TestBinStreamPool, PerThread) {
+    BinStreamPool::get().release(std::vector<char>(BinStreamPool::kMinPooledBytes));
+    std::thread([]() { EXPECT_EQ(BinStreamPool::get().get_num_buffers(), 0); }).join();
+    EXPECT_EQ(BinStreamPool::get().get_num_buffers(), 1);
+}
+
+TEST_F(TestBinStreamPool, RecycleAndReserve) {
+    BinStream stream;
+    stream.reserve(BinStreamPool::kMinPooledBytes);
+    const char* data = stream.get_remained_buffer();
+    stream << 1 << 2;
+    stream.recycle();
+    EXPECT_EQ(stream.size(), 0);
+    EXPECT_EQ(BinStreamPool::get().get_num_buffers(), 1);
+
+    BinStream another;
+    another.reserve(BinStreamPool::kMinPooledBytes);
+    EXPECT_EQ(another.get_remained_buffer(), data);
+    EXPECT_EQ(BinStreamPool::get().get_num_buffers(), 0);
+    another << 3;
+    int a;
+    another >> a;
+    EXPECT_EQ(a, 3);
+}
+
+}  // namespace
+}  // namespace husky
@@ -0,0 +1,76 @@
+// Copyright 2016 Husky Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/bloom_filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "base/hash.hpp"
+
+namespace husky {
+namespace base {
+
+BloomFilter::BloomFilter(size_t num_keys, double bits_per_key) {
+    if (num_keys == 0)
+        return;
+    size_t num_bits = std::max(static_cast<size_t>(num_keys * bits_per_key), static_cast<size_t>(64));
+    bits_.resize((num_bits + 63) / 64, 0);
+    // ln2 * bits_per_key probes minimize the false positive rate
+    num_probes_ = std::min(std::max(static_cast<int>(std::round(bits_per_key * 0.69)), 1), 30);
+}
+
+void BloomFilter::insert(size_t hash) {
+    if (bits_.empty())
+        return;
+    // Hashes of small integers are the integers themselves, so spread them before probing
+    uint64_t h = mix64(hash);
+    uint64_t delta = (h >> 32) | 1;
+    size_t num_bits = get_num_bits();
+    for (int i = 0; i < num_probes_; ++i) {
+        size_t pos = h % num_bits;
+        bits_[pos >> 6] |= 1ULL << (pos & 63);
+        h += delta;
+    }
+}
+
+bool BloomFilter::may_contain(size_t hash) const {
+    if (bits_.empty())
+        return false;
+    uint64_t h = mix64(hash);
+    uint64_t delta = (h >> 32) | 1;
+    size_t num_bits = get_num_bits();
+    for (int i = 0; i < num_probes_; ++i) {
+        size_t pos = h % num_bits;
+        if ((bits_[pos >> 6] & (1ULL << (pos & 63))) == 0)
+            return false;
+        h += delta;
+    }
+    return true;
+}
+
+BinStream& operator<<(BinStream& stream, const BloomFilter& filter) {
+    stream << filter.num_probes_ << filter.bits_;
+    return stream;
+}
+
+BinStream& operator>>(BinStream& stream, BloomFilter& filter) {
+    stream >> filter.num_probes_ >> filter.bits_;
+    return stream;
+}
+
+}  // namespace base
+}  // namespace husky
@@ -0,0 +1,53 @@
+// Copyright 2016 Husky Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "base/serialization.hpp"
+
+namespace husky {
+namespace base {
+
+/// A Bloom filter over hash values of keys.
+///
+/// may_contain() never gives false negatives. Its false positive rate is about 0.6185^bits_per_key
+/// with the default number of probes. The probes are derived from one hash value by double hashing.
+class BloomFilter {
+   public:
+    BloomFilter() = default;
+
+    /// @param num_keys Expected number of keys to insert
+    /// @param bits_per_key Bits of the filter for each key
+    BloomFilter(size_t num_keys, double bits_per_key);
+
+    void insert(size_t hash);
+    bool may_contain(size_t hash) const;
+
+    inline size_t get_num_bits() const { return bits_.size() * 64; }
+    inline int get_num_probes() const { return num_probes_; }
+
+    friend BinStream& operator<<(BinStream& stream, const BloomFilter& filter);
+    friend BinStream& operator>>(BinStream& stream, BloomFilter& filter);
+
+   protected:
+    std::vector<uint64_t> bits_;
+    int num_probes_ = 0;
+};
+
+}  // namespace base
+}  // namespace husky
@@ -0,0 +1,60 @@
+#include "base/bloom_filter.hpp"
+
+#include <functional>
+
+#include "gtest/gtest.h"
+
+#include "base/serialization.hpp"
+
+namespace husky {
+namespace {
+
+using base::BinStream;
+using base::BloomFilter;
+
+class TestBloomFilter : public testing::Test {
+   public:
+    TestBloomFilter() {}
+    ~TestBloomFilter() {}
+
+   protected:
+    void SetUp() {}
+    void TearDown() {}
+};
+
+TEST_F(TestBloomFilter, Empty) {
+    BloomFilter filter(0, 10);
+    EXPECT_EQ(filter.get_num_bits(), 0);
+    filter.insert(std::hash<int>()(1));
+    EXPECT_FALSE(filter.may_contain(std::hash<int>()(1)));
+}
+
+TEST_F(TestBloomFilter, NoFalseNegative) {
+    BloomFilter filter(1000, 10);
+    for (int i = 0; i < 2000; i += 2)
+        filter.insert(std::hash<int>()(i));
+    int false_positives = 0;
+    for (int i = 0; i < 2000; i += 2) {
+        EXPECT_TRUE(filter.may_contain(std::hash<int>()(i)));
+        false_positives += filter.may_contain(std::hash<int>()(i + 1));
+    }
+    // The expected false positive rate is below 1%
+    EXPECT_LT(false_positives, 50);
+}
+
+TEST_F(TestBloomFilter, Serialization) {
+    BloomFilter filter(100, 8);
+    for (int i = 0; i < 100; ++i)
+        filter.insert(std::hash<int>()(i));
+    BinStream bin;
+    bin << filter;
+    BloomFilter recv_filter;
+    bin >> recv_filter;
+    EXPECT_EQ(recv_filter.get_num_bits(), filter.get_num_bits());
+    EXPECT_EQ(recv_filter.get_num_probes(), filter.get_num_probes());
+    for (int i = 0; i < 100; ++i)
+        EXPECT_TRUE(recv_filter.may_contain(std::hash<int>()(i)));
+}
+
+}  // namespace
+}  // namespace husky
@@ -0,0 +1,170 @@
+// Copyright 2016 Husky Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/compression.hpp"
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef WITH_LZ4
+#include "lz4.h"
+#endif
+#ifdef WITH_ZSTD
+#include "zstd.h"
+#endif
+
+#include "base/binstream_pool.hpp"
+#include "base/exception.hpp"
+
+namespace husky {
+namespace base {
+
+namespace {
+
+// A compressed stream ends with [raw size: uint64_t][codec: uint8_t], and an uncompressed one with [codec] only
+const size_t kRawSizeBytes = sizeof(uint64_t);
+const size_t kCodecBytes = sizeof(uint8_t);
+// Zstd level 1 trades ratio for speed, which suits the streams sent in every superstep
+const int kZstdLevel = 1;
+
+size_t compress_bound(CompressionCodec codec, size_t size) {
+    switch (codec) {
+#ifdef WITH_LZ4
+    case CompressionCodec::LZ4:
+        return LZ4_compressBound(static_cast<int>(size));
+#endif
+#ifdef WITH_ZSTD
+    case CompressionCodec::Zstd:
+        return ZSTD_compressBound(size);
+#endif
+    default:
+        throw HuskyException("Compression codec " + std::to_string(static_cast<int>(codec)) + " is not available");
+    }
+}
+
+// Return the compressed size, or 0 if the codec fails to compress
+size_t compress_block(CompressionCodec codec, const char* src, size_t size, char* dst, size_t capacity) {
+    switch (codec) {
+#ifdef WITH_LZ4
+    case CompressionCodec::LZ4:
+        return LZ4_compress_default(src, dst, static_cast<int>(size), static_cast<int>(capacity));
+#endif
+#ifdef WITH_ZSTD
+    case CompressionCodec::Zstd: {
+        size_t ret = ZSTD_compress(dst, capacity, src, size, kZstdLevel);
+        return ZSTD_isError(ret) ? 0 : ret;
+    }
+#endif
+    default:
+        return 0;
+    }
+}
+
+void decompress_block(CompressionCodec codec, const char* src, size_t size, char* dst, size_t raw_size) {
+    bool ok = false;
+    switch (codec) {
+#ifdef WITH_LZ4
+    case CompressionCodec::LZ4:
+        ok = LZ4_decompress_safe(src, dst, static_cast<int>(size), static_cast<int>(raw_size)) ==
+             static_cast<int>(raw_size);
+        break;
+#endif
+#ifdef WITH_ZSTD
+    case CompressionCodec::Zstd:
+        ok = ZSTD_decompress(dst, raw_size, src, size) == raw_size;
+        break;
+#endif
+    default:
+        throw HuskyException("Compression codec " + std::to_string(static_cast<int>(codec)) + " is not available");
+    }
+    if (!ok)
+        throw HuskyException("Corrupted compressed BinStream");
+}
+
+}  // namespace
+
+bool is_compression_available(CompressionCodec codec) {
+    switch (codec) {
+    case CompressionCodec::None:
+        return true;
+#ifdef WITH_LZ4
+    case CompressionCodec::LZ4:
+        return true;
+#endif
+#ifdef WITH_ZSTD
+    case CompressionCodec::Zstd:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+void compress(BinStream* bin, CompressionCodec codec) {
+    size_t size = bin->size();
+    if (codec != CompressionCodec::None && size > 0) {
+        size_t capacity = compress_bound(codec, size);
+        std::vector<char> buffer = BinStreamPool::get().acquire(capacity + kRawSizeBytes + kCodecBytes);
+        buffer.resize(capacity);
+        size_t compressed_size = compress_block(codec, bin->get_remained_buffer(), size, buffer.data(), capacity);
+        if (compressed_size > 0 && compressed_size + kRawSizeBytes < size) {
+            buffer.resize(compressed_size);
+            uint64_t raw_size = size;
+            buffer.insert(buffer.end(), reinterpret_cast<const char*>(&raw_size),
+                          reinterpret_cast<const char*>(&raw_size) + kRawSizeBytes);
+            buffer.push_back(static_cast<char>(codec));
+            bool compact = bin->is_compact();
+            bin->recycle();
+            *bin = BinStream(std::move(buffer));
+            bin->set_compact(compact);
+            bin->set_compressed(true);
+            return;
+        }
+        BinStreamPool::get().release(std::move(buffer));
+    }
+    char none = static_cast<char>(CompressionCodec::None);
+    bin->push_back_bytes(&none, kCodecBytes);
+    bin->set_compressed(true);
+}
+
+void decompress(BinStream* bin) {
+    size_t size = bin->size();
+    if (size < kCodecBytes)
+        throw HuskyException("Corrupted compressed BinStream");
+    const char* data = bin->get_remained_buffer();
+    auto codec = static_cast<CompressionCodec>(data[size - kCodecBytes]);
+    if (codec == CompressionCodec::None) {
+        bin->pop_back_bytes(kCodecBytes);
+        bin->set_compressed(false);
+        return;
+    }
+    if (size < kRawSizeBytes + kCodecBytes)
+        throw HuskyException("Corrupted compressed BinStream");
+    size_t compressed_size = size - kRawSizeBytes - kCodecBytes;
+    uint64_t raw_size;
+    std::memcpy(&raw_size, data + compressed_size, kRawSizeBytes);
+    std::vector<char> buffer = BinStreamPool::get().acquire(raw_size);
+    buffer.resize(raw_size);
+    decompress_block(codec, data, compressed_size, buffer.data(), raw_size);
+    bool compact = bin->is_compact();
+    bin->recycle();
+    *bin = BinStream(std::move(buffer));
+    bin->set_compact(compact);
+}
+
+}  // namespace base
+}  // namespace husky
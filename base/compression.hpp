@@ -0,0 +1,43 @@
+// Copyright 2016 Husky Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "base/serialization.hpp"
+
+namespace husky {
+namespace base {
+
+/// Block compression codecs for BinStreams. LZ4 and Zstd are available when Husky is built with them.
+enum class CompressionCodec : uint8_t { None = 0, LZ4 = 1, Zstd = 2 };
+
+bool is_compression_available(CompressionCodec codec);
+
+/// \brief Compress the unread bytes of `bin` in place
+///
+/// The bytes are followed by a trailer telling decompress() how to restore them, so that the receiver needs
+/// not know the codec, and the stream is marked as BinStream::is_compressed(). With CompressionCodec::None,
+/// or when the codec does not make the stream smaller, the bytes are kept as they are and only the trailer
+/// is appended.
+void compress(BinStream* bin, CompressionCodec codec);
+
+/// Restore the bytes of a stream made by compress()
+void decompress(BinStream* bin);
+
+}  // namespace base
+}  // namespace husky
@@ -0,0 +1,97 @@
+#include "base/compression.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "base/exception.hpp"
+#include "base/serialization.hpp"
+
+namespace husky {
+namespace {
+
+using base::BinStream;
+using base::CompressionCodec;
+
+class TestCompression : public testing::Test {
+   public:
+    TestCompression() {}
+    ~TestCompression() {}
+
+   protected:
+    void SetUp() {}
+    void TearDown() {}
+};
+
+void check_round_trip(CompressionCodec codec) {
+    std::vector<std::string> words;
+    for (int i = 0; i < 10000; ++i)
+        words.push_back("word" + std::to_string(i % 100));
+    BinStream bin;
+    bin << words << 42;
+    size_t raw_size = bin.size();
+
+    EXPECT_FALSE(bin.is_compressed());
+    base::compress(&bin, codec);
+    EXPECT_TRUE(bin.is_compressed());
+    if (codec != CompressionCodec::None)
+        EXPECT_LT(bin.size(), raw_size);
+    base::decompress(&bin);
+    EXPECT_FALSE(bin.is_compressed());
+    EXPECT_EQ(bin.size(), raw_size);
+    std::vector<std::string> recv_words;
+    int recv_int;
+    bin >> recv_words >> recv_int;
+    EXPECT_EQ(recv_words, words);
+    EXPECT_EQ(recv_int, 42);
+}
+
+TEST_F(TestCompression, None) {
+    EXPECT_TRUE(base::is_compression_available(CompressionCodec::None));
+    check_round_trip(CompressionCodec::None);
+}
+
+TEST_F(TestCompression, Codecs) {
+    for (auto codec : {CompressionCodec::LZ4, CompressionCodec::Zstd})
+        if (base::is_compression_available(codec))
+            check_round_trip(codec);
+}
+
+TEST_F(TestCompression, Incompressible) {
+    for (auto codec : {CompressionCodec::LZ4, CompressionCodec::Zstd}) {
+        if (!base::is_compression_available(codec))
+            continue;
+        // Too small to compress, so it is kept as it is
+        BinStream bin;
+        bin << 1 << 2;
+        base::compress(&bin, codec);
+        EXPECT_EQ(bin.size(), 2 * sizeof(int) + 1);
+        base::decompress(&bin);
+        int a, b;
+        bin >> a >> b;
+        EXPECT_EQ(a, 1);
+        EXPECT_EQ(b, 2);
+    }
+}
+
+TEST_F(TestCompression, View) {
+    BinStream bin;
+    bin << std::string(10000, 'a');
+    base::compress(&bin, CompressionCodec::None);
+    std::shared_ptr<std::vector<char>> owner(new std::vector<char>(bin.get_buffer_vector()));
+    BinStream view = BinStream::view(owner->data(), owner->size(), owner);
+    base::decompress(&view);
+    std::string recv_str;
+    view >> recv_str;
+    EXPECT_EQ(recv_str, std::string(10000, 'a'));
+}
+
+TEST_F(TestCompression, Corrupted) {
+    BinStream bin;
+    EXPECT_THROW(base::decompress(&bin), base::HuskyException);
+}
+
+}  // namespace
+}  // namespace husky
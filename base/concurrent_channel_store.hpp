@@ -23,12 +23,13 @@ namespace base {
 template <typename ValT>
 class ConcurrentChannelStore {
    public:
+    // Rows are indexed by channel id and columns by progress
     static const int kNCol = 50;
     static const int kNRow = 50;
 
     ValT& get(int x, int y) {
-        assert(x < 50);
-        return cells_[x][y % 50];
+        assert(x < kNRow);
+        return cells_[x][y % kNCol];
     }
 
     void init(ValT val) {
@@ -14,6 +14,7 @@
 
 #include "base/generation_lock.hpp"
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <unordered_map>
@@ -22,14 +23,15 @@
 namespace husky {
 namespace base {
 
+std::atomic<size_t> GenerationBase::s_num_instances(0);
 thread_local std::unordered_map<GenerationBase*, std::pair<size_t, size_t>> GenerationBase::count_;
 
 void GenerationBase::inc_generation() { ++generation_; }
 
 size_t GenerationBase::inc_count() {
     std::pair<size_t, size_t>& self_gen = count_[this];
-    if (self_gen.first != time_stamp_) {
-        self_gen.first = time_stamp_;
+    if (self_gen.first != instance_id_) {
+        self_gen.first = instance_id_;
         self_gen.second = 0;
     }
     return ++self_gen.second;
@@ -14,13 +14,12 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <unordered_map>
 #include <utility>
 
-#include "base/time.hpp"
-
 namespace husky {
 namespace base {
 
@@ -33,7 +32,9 @@ class GenerationBase {
     size_t get_generation();
 
    private:
-    size_t time_stamp_ = base::get_current_time_milliseconds();
+    // Tells the object from an earlier one at the same address, whose counts the threads may still keep
+    size_t instance_id_ = s_num_instances.fetch_add(1);
+    static std::atomic<size_t> s_num_instances;
     size_t generation_ = 0;
     static thread_local std::unordered_map<GenerationBase*, std::pair<size_t, size_t>> count_;
 };
@@ -14,10 +14,43 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <string>
 #include <utility>
 
+namespace husky {
+namespace base {
+
+/// The 64-bit finalizer of MurmurHash3. Every input bit affects every output bit, so sequential or strided
+/// keys (for which std::hash is the identity) are spread evenly over the whole range.
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/// Hash a byte sequence 8 bytes at a time, e.g., a string key or a view of it
+inline uint64_t hash_bytes(const char* data, size_t size) {
+    uint64_t h = size * 0x9e3779b97f4a7c15ULL;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(uint64_t));
+        h = mix64(h ^ word);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    return mix64(h ^ tail);
+}
+
+}  // namespace base
+}  // namespace husky
+
 namespace std {
 
 template <>
@@ -51,5 +51,12 @@ TEST_F(TestHash, CheckHashValue) {
     EXPECT_EQ(hash_pair_string(pair_string), hash_string(sa) ^ hash_string(sb));
 }
 
+TEST_F(TestHash, Mix64) {
+    // The reference values of the MurmurHash3 finalizer
+    EXPECT_EQ(base::mix64(0), 0);
+    EXPECT_EQ(base::mix64(1), 0xb456bcfc34c2cb2cULL);
+    EXPECT_EQ(base::mix64(0x123456789abcdef0ULL), 0x18b8c062f6f42398ULL);
+}
+
 }  // namespace
 }  // namespace husky
@@ -0,0 +1,88 @@
+// Copyright 2016 Husky Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <utility>
+
+namespace husky {
+namespace base {
+
+/// \brief A lock-free multi-producer single-consumer queue
+///
+/// It has the interface of ConcurrentQueue, but only one thread may pop or clear it at a time.
+/// push() is wait-free: it swaps the head of a linked list and links the new node behind the old head.
+/// A consumer which finds the next node not yet linked by a preempted producer spins until it is,
+/// so pop() must only be invoked when size() > 0.
+template <typename ElementT>
+class MPSCQueue {
+   public:
+    MPSCQueue() : head_(new Node()), tail_(head_.load()) {}
+
+    ~MPSCQueue() {
+        clear();
+        delete tail_;
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    inline bool is_empty() const { return size_ == 0; }
+    inline int size() const { return size_; }
+
+    // Has to use std::move for `&&` parameter.
+    void push(ElementT&& element) {
+        Node* node = new Node(std::move(element));
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+        ++size_;
+    }
+
+    ElementT pop() {
+        Node* next = tail_->next.load(std::memory_order_acquire);
+        while (next == nullptr) {
+            std::this_thread::yield();
+            next = tail_->next.load(std::memory_order_acquire);
+        }
+        ElementT element = std::move(next->element);
+        delete tail_;
+        tail_ = next;
+        --size_;
+        return element;
+    }
+
+    void clear() {
+        while (size_ > 0)
+            pop();
+    }
+
+   private:
+    struct Node {
+        Node() : next(nullptr) {}
+        explicit Node(ElementT&& e) : next(nullptr), element(std::move(e)) {}
+        std::atomic<Node*> next;
+        ElementT element;
+    };
+
+    std::atomic<int> size_{0};
+    // Producers append to the head, and the consumer pops behind the tail, which is a consumed dummy node
+    std::atomic<Node*> head_;
+    Node* tail_;
+};
+
+}  // namespace base
+}  // namespace husky
@@ -0,0 +1,76 @@
+#include "base/mpsc_queue.hpp"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace husky {
+namespace {
+
+using base::MPSCQueue;
+
+class TestMPSCQueue : public testing::Test {
+   public:
+    TestMPSCQueue() {}
+    ~TestMPSCQueue() {}
+
+   protected:
+    void SetUp() {}
+    void TearDown() {}
+};
+
+TEST_F(TestMPSCQueue, PushAndPop) {
+    MPSCQueue<int> queue;
+    ASSERT_TRUE(queue.is_empty());
+    std::vector<int> data = {1, 3, -6, 0};
+
+    for (int i = 0; i < data.size(); ++i)
+        queue.push(std::move(data[i]));
+    EXPECT_EQ(queue.size(), 4);
+
+    for (int i = 0; i < data.size(); ++i)
+        EXPECT_EQ(queue.pop(), data[i]);
+    ASSERT_TRUE(queue.is_empty());
+}
+
+TEST_F(TestMPSCQueue, Clear) {
+    MPSCQueue<std::vector<int>> queue;
+    queue.push(std::vector<int>{1, 2});
+    queue.push(std::vector<int>{3});
+    queue.clear();
+    ASSERT_TRUE(queue.is_empty());
+    queue.push(std::vector<int>{4});
+    EXPECT_EQ(queue.pop(), std::vector<int>{4});
+}
+
+TEST_F(TestMPSCQueue, ConcurrentPush) {
+    MPSCQueue<int> queue;
+    int num_thread = 4;
+    int push_size = 10000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_thread; i++) {
+        threads.emplace_back([&queue, i, push_size]() {
+            for (int j = 0; j < push_size; j++)
+                queue.push(i * push_size + j);
+        });
+    }
+
+    // Pop while pushing, and the elements of each producer keep their order
+    std::vector<int> last(num_thread, -1);
+    for (int popped = 0; popped < num_thread * push_size;) {
+        if (queue.size() == 0)
+            continue;
+        int element = queue.pop();
+        int producer = element / push_size;
+        EXPECT_GT(element % push_size, last[producer]);
+        last[producer] = element % push_size;
+        popped += 1;
+    }
+    for (auto& th : threads)
+        th.join();
+    ASSERT_TRUE(queue.is_empty());
+}
+
+}  // namespace
+}  // namespace husky
@@ -14,9 +14,12 @@
 
 #include "base/serialization.hpp"
 
+#include <cstring>
 #include <string>
 #include <vector>
 
+#include "base/binstream_pool.hpp"
+
 namespace husky {
 namespace base {
 
@@ -30,58 +33,140 @@ BinStream::BinStream(const std::vector<char>& v) : front_(0), buffer_(v) {}
 
 BinStream::BinStream(std::vector<char>&& v) : front_(0), buffer_(std::move(v)) {}
 
-BinStream::BinStream(const BinStream& stream) {
-    front_ = stream.front_;
+BinStream::BinStream(const BinStream& stream)
+    : front_(stream.front_),
+      compact_(stream.compact_),
+      compressed_(stream.compressed_),
+      view_(stream.view_),
+      view_size_(stream.view_size_),
+      view_owner_(stream.view_owner_) {
     buffer_ = stream.buffer_;
 }
 
-BinStream::BinStream(BinStream&& stream) : front_(stream.front_), buffer_(std::move(stream.buffer_)) {
+BinStream::BinStream(BinStream&& stream)
+    : front_(stream.front_),
+      buffer_(std::move(stream.buffer_)),
+      compact_(stream.compact_),
+      compressed_(stream.compressed_),
+      view_(stream.view_),
+      view_size_(stream.view_size_),
+      view_owner_(std::move(stream.view_owner_)) {
     stream.front_ = 0;
+    stream.compressed_ = false;
+    stream.view_ = nullptr;
+    stream.view_size_ = 0;
 }
 
 BinStream& BinStream::operator=(BinStream&& stream) {
     front_ = stream.front_;
     buffer_ = std::move(stream.buffer_);
+    compact_ = stream.compact_;
+    compressed_ = stream.compressed_;
+    view_ = stream.view_;
+    view_size_ = stream.view_size_;
+    view_owner_ = std::move(stream.view_owner_);
     stream.front_ = 0;
+    stream.compressed_ = false;
+    stream.view_ = nullptr;
+    stream.view_size_ = 0;
     return *this;
 }
 
+BinStream BinStream::view(const char* src, size_t sz, std::shared_ptr<void> owner) {
+    BinStream stream;
+    stream.view_ = src;
+    stream.view_size_ = sz;
+    stream.view_owner_ = std::move(owner);
+    return stream;
+}
+
+void BinStream::own_buffer() {
+    if (view_ == nullptr)
+        return;
+    buffer_.assign(view_, view_ + view_size_);
+    view_ = nullptr;
+    view_size_ = 0;
+    view_owner_.reset();
+}
+
 size_t BinStream::hash() {
     size_t ret = 0;
-    for (auto& i : buffer_)
-        ret += i;
+    for (size_t i = 0; i < end(); ++i)
+        ret += data()[i];
     return ret;
 }
 
 void BinStream::clear() {
+    view_ = nullptr;
+    view_size_ = 0;
+    view_owner_.reset();
     buffer_.clear();
     front_ = 0;
+    compressed_ = false;
 }
 
 void BinStream::purge() {
+    view_ = nullptr;
+    view_size_ = 0;
+    view_owner_.reset();
     std::vector<char> tmp;
     buffer_.swap(tmp);
     front_ = 0;
+    compressed_ = false;
 }
 
 void BinStream::resize(size_t size) {
-    buffer_.resize(size);
+    if (view_ != nullptr && size <= view_size_)
+        view_size_ = size;
+    else {
+        own_buffer();
+        buffer_.resize(size);
+    }
     front_ = 0;
 }
 
 void BinStream::seek(size_t pos) { front_ = pos; }
 
+void BinStream::reserve(size_t sz) {
+    own_buffer();
+    if (buffer_.capacity() >= sz)
+        return;
+    if (buffer_.empty()) {
+        auto& pool = BinStreamPool::get();
+        pool.release(std::move(buffer_));
+        buffer_ = pool.acquire(sz);
+    } else {
+        buffer_.reserve(sz);
+    }
+}
+
+void BinStream::recycle() {
+    if (view_ == nullptr)
+        BinStreamPool::get().release(std::move(buffer_));
+    purge();
+}
+
 void BinStream::push_back_bytes(const char* src, size_t sz) {
+    own_buffer();
     buffer_.insert(buffer_.end(), (const char*) src, (const char*) src + sz);
 }
 
 void* BinStream::pop_front_bytes(size_t sz) {
-    assert(front_ <= buffer_.size());
-    void* ret = &buffer_[front_];
+    assert(front_ <= end());
+    // The bytes of a view are only read through the returned pointer
+    void* ret = const_cast<char*>(data()) + front_;
     front_ += sz;
     return ret;
 }
 
+void BinStream::pop_back_bytes(size_t sz) {
+    assert(sz <= size());
+    if (view_ != nullptr)
+        view_size_ -= sz;
+    else
+        buffer_.resize(buffer_.size() - sz);
+}
+
 void BinStream::append(const BinStream& stream) { push_back_bytes(stream.get_remained_buffer(), stream.size()); }
 
 BinStream& operator<<(BinStream& stream, const BinStream& bin) {
@@ -94,8 +179,8 @@ BinStream& operator>>(BinStream& stream, BinStream& bin) {
     size_t len;
     stream >> len;
     bin.resize(len);
-    for (char* i = bin.get_buffer(); len--; i++)
-        stream >> *i;
+    if (len != 0)
+        std::memcpy(bin.get_buffer(), stream.pop_front_bytes(len), len);
     return stream;
 }
 
@@ -113,6 +198,20 @@ BinStream& operator>>(BinStream& stream, std::string& x) {
     return stream;
 }
 
+BinStream& operator<<(BinStream& stream, const StringRef& x) {
+    size_t len = x.size();
+    stream << len;
+    stream.push_back_bytes(x.data(), len);
+    return stream;
+}
+
+BinStream& operator>>(BinStream& stream, StringRef& x) {
+    size_t len;
+    stream >> len;
+    x = StringRef(reinterpret_cast<const char*>(stream.pop_front_bytes(len)), len);
+    return stream;
+}
+
 BinStream& operator<<(BinStream& stream, const std::vector<bool>& v) {
     size_t len = v.size();
     stream << len;
@@ -14,12 +14,15 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <tuple>
 #include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
@@ -44,30 +47,103 @@ class BinStream {
 
     BinStream& operator=(BinStream&& stream);
 
+    /// Create a read-only stream over `sz` bytes at `src` without copying them.
+    /// The bytes must stay valid while `owner` is alive, and the stream shares the ownership of `owner`.
+    /// Writing to the view (or asking for its buffer) copies the bytes into a buffer of its own first.
+    static BinStream view(const char* src, size_t sz, std::shared_ptr<void> owner);
+
     size_t hash();
     void clear();
     void purge();
     void resize(size_t size);
     void seek(size_t pos);
+    /// Make room for `sz` bytes, taking a buffer from the BinStreamPool of this thread if the stream has none
+    void reserve(size_t sz);
+    /// Give the buffer to the BinStreamPool of this thread for reuse, and clear the stream like purge()
+    void recycle();
 
     void append(const BinStream& m);
     void push_back_bytes(const char* src, size_t sz);
     virtual void* pop_front_bytes(size_t sz);
-    virtual size_t size() const { return buffer_.size() - front_; }
+    /// Drop the last `sz` bytes, keeping the read position
+    void pop_back_bytes(size_t sz);
+    virtual size_t size() const { return end() - front_; }
+    inline bool is_view() const { return view_ != nullptr; }
+
+    /// \brief Write integers and enums wider than a byte as varints
+    ///
+    /// A compact stream writes them as LEB128 varints, zigzag-encoded if signed, which covers the lengths
+    /// of strings and containers, too. Ranges of such integers are then written element by element instead
+    /// of as one block. Both ends must use the same mode. The mode belongs to the stream rather than to its
+    /// bytes: clear(), purge() and recycle() keep it, and copies and moves take it over.
+    inline void set_compact(bool compact) { compact_ = compact; }
+    inline bool is_compact() const { return compact_; }
+
+    /// Whether the bytes end with the trailer of base::compress(), which the mailbox sends along with
+    /// the stream so that the receiver decompresses it. Unlike the compact mode, it belongs to the bytes:
+    /// clear(), purge() and recycle() reset it.
+    inline void set_compressed(bool compressed) { compressed_ = compressed; }
+    inline bool is_compressed() const { return compressed_; }
+
+    inline void push_back_varint(uint64_t x) {
+        char bytes[10];
+        size_t n = 0;
+        while (x >= 0x80) {
+            bytes[n++] = static_cast<char>(x | 0x80);
+            x >>= 7;
+        }
+        bytes[n++] = static_cast<char>(x);
+        push_back_bytes(bytes, n);
+    }
+    inline uint64_t pop_front_varint() {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data()) + front_;
+        uint64_t x = p[0];
+        if (x < 0x80) {
+            front_ += 1;
+            return x;
+        }
+        x &= 0x7f;
+        size_t n = 1;
+        for (int shift = 7;; shift += 7) {
+            uint64_t b = p[n++];
+            x |= (b & 0x7f) << shift;
+            if (b < 0x80)
+                break;
+        }
+        front_ += n;
+        return x;
+    }
 
     /// Note that this method just returns the pointer pointing to the very
     /// beginning of the buffer_, and doesn't care about how much data have
     /// been read.
-    inline char* get_buffer() { return &buffer_[0]; }
-    inline const std::vector<char>& get_buffer_vector() { return buffer_; }
-    inline const char* get_remained_buffer() const { return (&buffer_[0]) + front_; }
-    inline std::string to_string() const { return std::string(buffer_.begin() + front_, buffer_.end()); }
+    inline char* get_buffer() {
+        own_buffer();
+        return &buffer_[0];
+    }
+    inline const std::vector<char>& get_buffer_vector() {
+        own_buffer();
+        return buffer_;
+    }
+    inline const char* get_remained_buffer() const { return data() + front_; }
+    inline std::string to_string() const { return std::string(data() + front_, data() + end()); }
 
    protected:
     std::vector<char> buffer_;
 
    private:
+    inline const char* data() const { return view_ ? view_ : buffer_.data(); }
+    inline size_t end() const { return view_ ? view_size_ : buffer_.size(); }
+    // Copy the viewed bytes into buffer_ so that the stream can be modified
+    void own_buffer();
+
     size_t front_;
+    bool compact_ = false;
+    bool compressed_ = false;
+    // Set when the stream is a read-only view of bytes owned by view_owner_
+    const char* view_ = nullptr;
+    size_t view_size_ = 0;
+    std::shared_ptr<void> view_owner_;
 };
 
 template <typename T>
@@ -114,11 +190,60 @@ typename std::enable_if<has_deserialize<OutputT>::value, BinStream>::type& opera
     return stream;
 }
 
+/// is_varint_serializable<T> tells whether a compact BinStream writes T as a varint
+template <typename T>
+struct is_varint_serializable
+    : std::integral_constant<bool, (std::is_integral<T>::value || std::is_enum<T>::value) && (sizeof(T) > 1)> {};
+
+namespace detail {
+
+template <typename T, bool = std::is_enum<T>::value>
+struct integral_of {
+    typedef T type;
+};
+
+template <typename T>
+struct integral_of<T, true> {
+    typedef typename std::underlying_type<T>::type type;
+};
+
+template <typename T>
+typename std::enable_if<is_varint_serializable<T>::value>::type push_back_varint(BinStream& stream, const T& x) {
+    typedef typename integral_of<T>::type IntT;
+    if (std::is_signed<IntT>::value) {
+        int64_t v = static_cast<int64_t>(static_cast<IntT>(x));
+        stream.push_back_varint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+    } else {
+        stream.push_back_varint(static_cast<uint64_t>(static_cast<IntT>(x)));
+    }
+}
+
+template <typename T>
+typename std::enable_if<is_varint_serializable<T>::value>::type pop_front_varint(BinStream& stream, T& x) {
+    typedef typename integral_of<T>::type IntT;
+    uint64_t v = stream.pop_front_varint();
+    if (std::is_signed<IntT>::value)
+        x = static_cast<T>(static_cast<IntT>(static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1)));
+    else
+        x = static_cast<T>(static_cast<IntT>(v));
+}
+
+// Never called, since compact streams only take the overloads above for the types which are not varints
+template <typename T>
+typename std::enable_if<!is_varint_serializable<T>::value>::type push_back_varint(BinStream&, const T&) {}
+template <typename T>
+typename std::enable_if<!is_varint_serializable<T>::value>::type pop_front_varint(BinStream&, T&) {}
+
+}  // namespace detail
+
 template <typename InputT>
 typename std::enable_if<!has_serialize<InputT>::value, BinStream>::type& operator<<(BinStream& stream,
                                                                                     const InputT& x) {
     static_assert(IS_TRIVIALLY_COPYABLE(InputT), "For non trivially copyable type, serialization functions are needed");
-    stream.push_back_bytes((char*) &x, sizeof(InputT));
+    if (is_varint_serializable<InputT>::value && stream.is_compact())
+        detail::push_back_varint(stream, x);
+    else
+        stream.push_back_bytes((char*) &x, sizeof(InputT));
     return stream;
 }
 
@@ -126,7 +251,167 @@ template <typename OutputT>
 typename std::enable_if<!has_deserialize<OutputT>::value, BinStream>::type& operator>>(BinStream& stream, OutputT& x) {
     static_assert(IS_TRIVIALLY_COPYABLE(OutputT),
                   "For non trivially copyable type, serialization functions are needed");
-    x = *(OutputT*) (stream.pop_front_bytes(sizeof(OutputT)));
+    if (is_varint_serializable<OutputT>::value && stream.is_compact())
+        detail::pop_front_varint(stream, x);
+    else
+        x = *(OutputT*) (stream.pop_front_bytes(sizeof(OutputT)));
+    return stream;
+}
+
+namespace detail {
+
+// BinStreamProbe converts to BinStream& but does not live in namespace base, so an expression
+// `probe << x` only finds operators declared alongside the type of x (including hidden friends),
+// never the generic operators above.
+struct BinStreamProbe {
+    operator BinStream&() const;
+};
+
+// Hide the operators of the enclosing namespaces from unqualified lookup inside detail
+void operator<<(BinStreamProbe, BinStreamProbe);
+void operator>>(BinStreamProbe, BinStreamProbe);
+
+template <typename T>
+class has_custom_stream_operator {
+   private:
+    template <typename U>
+    static constexpr auto check(int) -> decltype(std::declval<BinStreamProbe&>() << std::declval<const U&>(),
+                                                 std::true_type());
+
+    template <typename U>
+    static constexpr auto check(long) -> decltype(std::declval<BinStreamProbe&>() >> std::declval<U&>(),
+                                                  std::true_type());
+
+    template <typename>
+    static constexpr std::false_type check(...);
+
+    typedef decltype(check<T>(0)) type;
+
+   public:
+    static constexpr bool value = type::value;
+};
+
+}  // namespace detail
+
+/// is_trivially_serializable<T> tells whether the wire format of T is exactly its object
+/// representation, so that a contiguous range of T can be written and read with one memcpy.
+/// It holds for trivially copyable types without serialize()/deserialize() members or
+/// user-defined stream operators, and for std::pair of such types without padding.
+/// Specialize it to std::false_type to force element-wise serialization of a type.
+template <typename T>
+struct is_trivially_serializable
+    : std::integral_constant<bool, IS_TRIVIALLY_COPYABLE(T) && !has_serialize<T>::value &&
+                                       !has_deserialize<T>::value && !detail::has_custom_stream_operator<T>::value> {};
+
+template <typename FirstT, typename SecondT>
+struct is_trivially_serializable<std::pair<FirstT, SecondT>>
+    : std::integral_constant<bool, is_trivially_serializable<FirstT>::value &&
+                                       is_trivially_serializable<SecondT>::value &&
+                                       sizeof(std::pair<FirstT, SecondT>) == sizeof(FirstT) + sizeof(SecondT)> {};
+
+template <typename T, typename = void>
+struct serialized_size;
+
+namespace detail {
+
+// Copy a T of a nonzero serialized_size from or to its bytes in a stream that is not compact
+template <typename T, typename = void>
+struct FixedCodec;
+
+template <typename InputT>
+void serialize_range(BinStream& stream, const InputT* data, size_t n, std::false_type) {
+    for (size_t i = 0; i < n; ++i)
+        stream << data[i];
+}
+
+// Encode the elements into a block on the stack, so that the stream grows once per block rather than per field
+template <typename InputT>
+void serialize_range(BinStream& stream, const InputT* data, size_t n, std::true_type) {
+    const size_t kSize = serialized_size<InputT>::value;
+    char block[4096];
+    if (stream.is_compact() || kSize > sizeof(block)) {
+        serialize_range(stream, data, n, std::false_type());
+        return;
+    }
+    const size_t kNumPerBlock = sizeof(block) / kSize;
+    for (size_t i = 0; i < n; i += kNumPerBlock) {
+        size_t num = std::min(kNumPerBlock, n - i);
+        char* bytes = block;
+        for (size_t j = i; j < i + num; ++j)
+            FixedCodec<InputT>::write(bytes, data[j]);
+        stream.push_back_bytes(block, num * kSize);
+    }
+}
+
+template <typename OutputT>
+void deserialize_range(BinStream& stream, OutputT* data, size_t n, std::false_type) {
+    for (size_t i = 0; i < n; ++i)
+        stream >> data[i];
+}
+
+// Take the bytes of all elements at once and copy the fields out of them
+template <typename OutputT>
+void deserialize_range(BinStream& stream, OutputT* data, size_t n, std::true_type) {
+    if (stream.is_compact() || n == 0) {
+        deserialize_range(stream, data, n, std::false_type());
+        return;
+    }
+    assert(n * serialized_size<OutputT>::value <= stream.size());
+    const char* bytes = static_cast<const char*>(stream.pop_front_bytes(n * serialized_size<OutputT>::value));
+    for (size_t i = 0; i < n; ++i)
+        FixedCodec<OutputT>::read(bytes, data[i]);
+}
+
+}  // namespace detail
+
+/// has_varint_fields<T> tells whether a compact BinStream writes T (or a part of a std::pair) as a varint
+template <typename T>
+struct has_varint_fields : is_varint_serializable<T> {};
+
+template <typename FirstT, typename SecondT>
+struct has_varint_fields<std::pair<FirstT, SecondT>>
+    : std::integral_constant<bool, has_varint_fields<FirstT>::value || has_varint_fields<SecondT>::value> {};
+
+/// Write n consecutive elements without a length prefix.
+/// Trivially serializable elements are copied as a single block, unless a compact stream writes them as varints.
+/// Other elements of a fixed serialized_size, such as those with HUSKY_SERIALIZE, are copied field by field into
+/// blocks of a few KB.
+template <typename InputT>
+typename std::enable_if<is_trivially_serializable<InputT>::value, BinStream>::type& serialize_range(
+    BinStream& stream, const InputT* data, size_t n) {
+    if (has_varint_fields<InputT>::value && stream.is_compact()) {
+        for (size_t i = 0; i < n; ++i)
+            stream << data[i];
+    } else if (n != 0) {
+        stream.push_back_bytes(reinterpret_cast<const char*>(data), n * sizeof(InputT));
+    }
+    return stream;
+}
+
+template <typename InputT>
+typename std::enable_if<!is_trivially_serializable<InputT>::value, BinStream>::type& serialize_range(
+    BinStream& stream, const InputT* data, size_t n) {
+    detail::serialize_range(stream, data, n, std::integral_constant<bool, serialized_size<InputT>::value != 0>());
+    return stream;
+}
+
+/// Read n consecutive elements written by serialize_range into data
+template <typename OutputT>
+typename std::enable_if<is_trivially_serializable<OutputT>::value, BinStream>::type& deserialize_range(
+    BinStream& stream, OutputT* data, size_t n) {
+    if (has_varint_fields<OutputT>::value && stream.is_compact()) {
+        for (size_t i = 0; i < n; ++i)
+            stream >> data[i];
+    } else if (n != 0) {
+        std::memcpy(static_cast<void*>(data), stream.pop_front_bytes(n * sizeof(OutputT)), n * sizeof(OutputT));
+    }
+    return stream;
+}
+
+template <typename OutputT>
+typename std::enable_if<!is_trivially_serializable<OutputT>::value, BinStream>::type& deserialize_range(
+    BinStream& stream, OutputT* data, size_t n) {
+    detail::deserialize_range(stream, data, n, std::integral_constant<bool, serialized_size<OutputT>::value != 0>());
     return stream;
 }
 
@@ -134,9 +419,7 @@ template <typename InputT>
 BinStream& operator<<(BinStream& stream, const std::vector<InputT>& v) {
     size_t len = v.size();
     stream << len;
-    for (int i = 0; i < v.size(); ++i)
-        stream << v[i];
-    return stream;
+    return serialize_range(stream, v.data(), len);
 }
 
 template <typename OutputT>
@@ -145,9 +428,7 @@ BinStream& operator>>(BinStream& stream, std::vector<OutputT>& v) {
     stream >> len;
     v.clear();
     v.resize(len);
-    for (int i = 0; i < v.size(); ++i)
-        stream >> v[i];
-    return stream;
+    return deserialize_range(stream, v.data(), len);
 }
 
 template <typename K, typename V>
@@ -228,9 +509,7 @@ template <typename InputT>
 BinStream& operator<<(BinStream& stream, const std::basic_string<InputT>& v) {
     size_t len = v.size();
     stream << len;
-    for (auto& elem : v)
-        stream << elem;
-    return stream;
+    return serialize_range(stream, v.data(), len);
 }
 
 template <typename OutputT>
@@ -243,9 +522,7 @@ BinStream& operator>>(BinStream& stream, std::basic_string<OutputT>& v) {
     } catch (std::exception e) {
         assert(false);
     }
-    for (auto& elem : v)
-        stream >> elem;
-    return stream;
+    return deserialize_range(stream, &v[0], len);
 }
 
 template <typename FirstT, typename SecondT>
@@ -269,6 +546,297 @@ BinStream& operator>>(BinStream& stream, std::string& x);
 BinStream& operator<<(BinStream& stream, const std::vector<bool>& v);
 BinStream& operator>>(BinStream& stream, std::vector<bool>& v);
 
+/// A read-only view of a std::string in the buffer of a BinStream.
+///
+/// Reading a StringRef from a stream does not allocate, so a received key can be looked up and dropped
+/// without materializing a std::string. The view stays valid while the stream keeps its buffer, i.e.,
+/// until the stream is written to, cleared, recycled or destroyed.
+class StringRef {
+   public:
+    StringRef() {}
+    StringRef(const char* data, size_t size) : data_(data), size_(size) {}
+    StringRef(const std::string& str) : data_(str.data()), size_(str.size()) {}  // NOLINT(runtime/explicit)
+
+    inline const char* data() const { return data_; }
+    inline size_t size() const { return size_; }
+    inline bool empty() const { return size_ == 0; }
+    inline const char* begin() const { return data_; }
+    inline const char* end() const { return data_ + size_; }
+    inline char operator[](size_t i) const { return data_[i]; }
+
+    explicit operator std::string() const { return std::string(data_, size_); }
+    inline std::string to_string() const { return std::string(data_, size_); }
+
+    int compare(const StringRef& other) const {
+        int ret = size_ == 0 || other.size_ == 0 ? 0 : std::memcmp(data_, other.data_, std::min(size_, other.size_));
+        if (ret != 0)
+            return ret;
+        return size_ < other.size_ ? -1 : (size_ > other.size_ ? 1 : 0);
+    }
+
+   private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// std::string converts to StringRef, so these also compare a StringRef with a std::string
+inline bool operator==(const StringRef& a, const StringRef& b) { return a.size() == b.size() && a.compare(b) == 0; }
+inline bool operator!=(const StringRef& a, const StringRef& b) { return !(a == b); }
+inline bool operator<(const StringRef& a, const StringRef& b) { return a.compare(b) < 0; }
+inline bool operator>(const StringRef& a, const StringRef& b) { return a.compare(b) > 0; }
+inline bool operator<=(const StringRef& a, const StringRef& b) { return a.compare(b) <= 0; }
+inline bool operator>=(const StringRef& a, const StringRef& b) { return a.compare(b) >= 0; }
+inline bool operator==(const std::string& a, const StringRef& b) { return StringRef(a) == b; }
+inline bool operator==(const StringRef& a, const std::string& b) { return a == StringRef(b); }
+inline bool operator<(const std::string& a, const StringRef& b) { return StringRef(a) < b; }
+inline bool operator<(const StringRef& a, const std::string& b) { return a < StringRef(b); }
+
+/// Written like a std::string, so either can be read from it
+BinStream& operator<<(BinStream& stream, const StringRef& x);
+BinStream& operator>>(BinStream& stream, StringRef& x);
+
+/// A read-only view of a std::vector<T> in the buffer of a BinStream, for trivially serializable T.
+///
+/// Like StringRef, it stays valid while the stream keeps its buffer. The elements are not aligned in
+/// the buffer, so they are copied out one by one on access.
+template <typename T>
+class ArrayRef {
+    static_assert(is_trivially_serializable<T>::value, "ArrayRef only views trivially serializable elements");
+
+   public:
+    ArrayRef() {}
+    ArrayRef(const char* data, size_t size) : data_(data), size_(size) {}
+
+    inline size_t size() const { return size_; }
+    inline bool empty() const { return size_ == 0; }
+    inline T operator[](size_t i) const {
+        T x;
+        std::memcpy(static_cast<void*>(&x), data_ + i * sizeof(T), sizeof(T));
+        return x;
+    }
+    std::vector<T> to_vector() const {
+        std::vector<T> v(size_);
+        if (size_ != 0)
+            std::memcpy(static_cast<void*>(v.data()), data_, size_ * sizeof(T));
+        return v;
+    }
+
+   private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+template <typename T>
+BinStream& operator>>(BinStream& stream, ArrayRef<T>& x) {
+    // Compact streams do not keep such elements as a block
+    assert(!(has_varint_fields<T>::value && stream.is_compact()));
+    size_t len;
+    stream >> len;
+    x = ArrayRef<T>(reinterpret_cast<const char*>(stream.pop_front_bytes(len * sizeof(T))), len);
+    return stream;
+}
+
+/// The type which a T can be read into from a stream without allocating. It is T itself unless T has a
+/// view, and converts to T by static_cast.
+template <typename T>
+struct ref_type {
+    typedef T type;
+};
+
+template <>
+struct ref_type<std::string> {
+    typedef StringRef type;
+};
+
+/// serialized_size<T>::value is the number of bytes which every T takes in a BinStream that is not compact,
+/// or 0 if it varies, e.g., with the length of a container. Types with HUSKY_SERIALIZE have it, too.
+template <typename T, typename>
+struct serialized_size : std::integral_constant<size_t, is_trivially_serializable<T>::value ? sizeof(T) : 0> {};
+
+template <typename FirstT, typename SecondT>
+struct serialized_size<std::pair<FirstT, SecondT>>
+    : std::integral_constant<size_t, serialized_size<FirstT>::value == 0 || serialized_size<SecondT>::value == 0
+                                         ? 0
+                                         : serialized_size<FirstT>::value + serialized_size<SecondT>::value> {};
+
+namespace detail {
+
+template <typename T>
+struct to_void {
+    typedef void type;
+};
+
+// The total size of the fields of all but the given types is the size of a block of trivially serializable fields
+template <typename... Ts>
+struct trivial_fields_bytes : std::integral_constant<size_t, 0> {};
+
+template <typename T, typename... Ts>
+struct trivial_fields_bytes<T, Ts...>
+    : std::integral_constant<size_t, (is_trivially_serializable<T>::value ? sizeof(T) : 0) +
+                                         trivial_fields_bytes<Ts...>::value> {};
+
+template <typename... Ts>
+struct fields_serialized_size : std::integral_constant<size_t, 0> {};
+
+template <typename T>
+struct fields_serialized_size<T> : serialized_size<T> {};
+
+template <typename T, typename... Ts>
+struct fields_serialized_size<T, Ts...>
+    : std::integral_constant<size_t, serialized_size<T>::value == 0 || fields_serialized_size<Ts...>::value == 0
+                                         ? 0
+                                         : serialized_size<T>::value + fields_serialized_size<Ts...>::value> {};
+
+template <typename TupleT>
+struct tuple_serialized_size;
+
+template <typename... Ts>
+struct tuple_serialized_size<std::tuple<Ts...>> : fields_serialized_size<typename std::decay<Ts>::type...> {};
+
+// Write fields in order, gathering each run of trivially serializable fields into one push_back_bytes
+template <size_t kBlockBytes>
+class FieldWriter {
+   public:
+    explicit FieldWriter(BinStream& stream) : stream_(stream) {}
+
+    template <typename T>
+    typename std::enable_if<is_trivially_serializable<T>::value>::type write(const T& field) {
+        if (has_varint_fields<T>::value && stream_.is_compact()) {
+            flush();
+            stream_ << field;
+            return;
+        }
+        std::memcpy(block_ + size_, static_cast<const void*>(&field), sizeof(T));
+        size_ += sizeof(T);
+    }
+
+    template <typename T>
+    typename std::enable_if<!is_trivially_serializable<T>::value>::type write(const T& field) {
+        flush();
+        stream_ << field;
+    }
+
+    void flush() {
+        if (size_ != 0)
+            stream_.push_back_bytes(block_, size_);
+        size_ = 0;
+    }
+
+   private:
+    BinStream& stream_;
+    char block_[kBlockBytes + 1];
+    size_t size_ = 0;
+};
+
+template <typename T>
+typename std::enable_if<is_trivially_serializable<T>::value>::type read_field(BinStream& stream, T& field) {
+    if (has_varint_fields<T>::value && stream.is_compact())
+        stream >> field;
+    else
+        std::memcpy(static_cast<void*>(&field), stream.pop_front_bytes(sizeof(T)), sizeof(T));
+}
+
+template <typename T>
+typename std::enable_if<!is_trivially_serializable<T>::value>::type read_field(BinStream& stream, T& field) {
+    stream >> field;
+}
+
+template <typename TupleT, size_t... I>
+BinStream& serialize_fields(BinStream& stream, const TupleT& fields, std::index_sequence<I...>) {
+    FieldWriter<trivial_fields_bytes<typename std::decay<typename std::tuple_element<I, TupleT>::type>::type...>::value>
+        writer(stream);
+    int expand[] = {0, (writer.write(std::get<I>(fields)), 0)...};
+    (void) expand;
+    writer.flush();
+    return stream;
+}
+
+template <typename TupleT, size_t... I>
+BinStream& deserialize_fields(BinStream& stream, const TupleT& fields, std::index_sequence<I...>) {
+    int expand[] = {0, (read_field(stream, std::get<I>(fields)), 0)...};
+    (void) expand;
+    return stream;
+}
+
+}  // namespace detail
+
+/// Write the fields in a tuple of references, such as std::tie(a, b, c), in order
+template <typename... Ts>
+BinStream& serialize_fields(BinStream& stream, const std::tuple<Ts...>& fields) {
+    return detail::serialize_fields(stream, fields, std::index_sequence_for<Ts...>());
+}
+
+/// Read the fields written by serialize_fields() into a tuple of references
+template <typename... Ts>
+BinStream& deserialize_fields(BinStream& stream, const std::tuple<Ts...>& fields) {
+    return detail::deserialize_fields(stream, fields, std::index_sequence_for<Ts...>());
+}
+
+template <typename T>
+struct serialized_size<T, typename detail::to_void<decltype(std::declval<const T&>().husky_fields())>::type>
+    : detail::tuple_serialized_size<decltype(std::declval<const T&>().husky_fields())> {};
+
+namespace detail {
+
+template <typename T, typename>
+struct FixedCodec {
+    static_assert(is_trivially_serializable<T>::value, "Only types of a fixed serialized_size are copied");
+
+    static void write(char*& bytes, const T& x) {
+        std::memcpy(bytes, static_cast<const void*>(&x), sizeof(T));
+        bytes += sizeof(T);
+    }
+    static void read(const char*& bytes, T& x) {
+        std::memcpy(static_cast<void*>(&x), bytes, sizeof(T));
+        bytes += sizeof(T);
+    }
+};
+
+template <typename FirstT, typename SecondT>
+struct FixedCodec<std::pair<FirstT, SecondT>> {
+    static void write(char*& bytes, const std::pair<FirstT, SecondT>& x) {
+        FixedCodec<FirstT>::write(bytes, x.first);
+        FixedCodec<SecondT>::write(bytes, x.second);
+    }
+    static void read(const char*& bytes, std::pair<FirstT, SecondT>& x) {
+        FixedCodec<FirstT>::read(bytes, x.first);
+        FixedCodec<SecondT>::read(bytes, x.second);
+    }
+};
+
+// The fields are laid out in order without padding, as serialize_fields() writes them
+template <typename T>
+struct FixedCodec<T, typename to_void<decltype(std::declval<const T&>().husky_fields())>::type> {
+    static void write(char*& bytes, const T& x) {
+        auto fields = x.husky_fields();
+        write_fields(bytes, fields, std::make_index_sequence<std::tuple_size<decltype(fields)>::value>());
+    }
+    static void read(const char*& bytes, T& x) {
+        auto fields = x.husky_fields();
+        read_fields(bytes, fields, std::make_index_sequence<std::tuple_size<decltype(fields)>::value>());
+    }
+
+   private:
+    template <typename TupleT, size_t... I>
+    static void write_fields(char*& bytes, const TupleT& fields, std::index_sequence<I...>) {
+        int expand[] = {
+            0, (FixedCodec<typename std::decay<typename std::tuple_element<I, TupleT>::type>::type>::write(
+                    bytes, std::get<I>(fields)),
+                0)...};
+        (void) expand;
+    }
+    template <typename TupleT, size_t... I>
+    static void read_fields(const char*& bytes, const TupleT& fields, std::index_sequence<I...>) {
+        int expand[] = {
+            0, (FixedCodec<typename std::decay<typename std::tuple_element<I, TupleT>::type>::type>::read(
+                    bytes, std::get<I>(fields)),
+                0)...};
+        (void) expand;
+    }
+};
+
+}  // namespace detail
+
 template <typename Value>
 Value deser(BinStream& in) {
     Value v;
@@ -278,3 +846,22 @@ Value deser(BinStream& in) {
 
 }  // namespace base
 }  // namespace husky
+
+/// \brief Generate the stream operators of a class from a list of its fields
+///
+/// Put HUSKY_SERIALIZE(Vertex, vertexId, adj, pr) in the public part of `class Vertex` instead of writing
+/// operator<< and operator>> field by field. The fields are written and read in the listed order, so the two
+/// operators cannot disagree. Adjacent trivially serializable fields are written with one copy, containers go
+/// through their own operators (which copy vectors of trivially serializable elements as a block), and
+/// husky::base::serialized_size<Vertex> tells whether every Vertex takes the same number of bytes. If it does,
+/// ranges of Vertex, e.g., vectors and the objects and attributes that migrate, are read by taking the bytes of
+/// the whole range at once and copying the fields out of them, instead of going through the stream per field.
+#define HUSKY_SERIALIZE(Type, ...)                                                                        \
+    auto husky_fields() { return std::tie(__VA_ARGS__); }                                                 \
+    auto husky_fields() const { return std::tie(__VA_ARGS__); }                                           \
+    friend husky::base::BinStream& operator<<(husky::base::BinStream& stream, const Type& husky_obj) {    \
+        return husky::base::serialize_fields(stream, husky_obj.husky_fields());                           \
+    }                                                                                                     \
+    friend husky::base::BinStream& operator>>(husky::base::BinStream& stream, Type& husky_obj) {          \
+        return husky::base::deserialize_fields(stream, husky_obj.husky_fields());                         \
+    }
@@ -1,6 +1,8 @@
 #include "base/serialization.hpp"
 
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -36,6 +38,25 @@ class TestSerializationWithInheritance {
     int x;
 };
 
+class TestSerializationWithStreamOperator {
+   public:
+    TestSerializationWithStreamOperator() = default;
+    explicit TestSerializationWithStreamOperator(int y) : x(y) {}
+
+    friend BinStream& operator<<(BinStream& stream, const TestSerializationWithStreamOperator& t) {
+        return stream << static_cast<int64_t>(t.x);
+    }
+
+    friend BinStream& operator>>(BinStream& stream, TestSerializationWithStreamOperator& t) {
+        int64_t y;
+        stream >> y;
+        t.x = static_cast<int>(y);
+        return stream;
+    }
+
+    int x = 0;
+};
+
 class TestSerializationWithInheritanceSubclass : public TestSerializationWithInheritance {
    public:
     explicit TestSerializationWithInheritanceSubclass(int y) : TestSerializationWithInheritance(y) {}
@@ -133,6 +154,67 @@ TEST_F(TestSerialization, Vector) {
         EXPECT_EQ(output[i], input[i]);
 }
 
+TEST_F(TestSerialization, TriviallySerializable) {
+    EXPECT_TRUE(base::is_trivially_serializable<int>::value);
+    EXPECT_TRUE((base::is_trivially_serializable<std::pair<int, float>>::value));
+    // Padding between first and second is not part of the wire format
+    EXPECT_FALSE((base::is_trivially_serializable<std::pair<int, double>>::value));
+    EXPECT_FALSE(base::is_trivially_serializable<TestSerializationWithInheritance>::value);
+    EXPECT_FALSE(base::is_trivially_serializable<TestSerializationWithStreamOperator>::value);
+    EXPECT_FALSE(base::is_trivially_serializable<std::string>::value);
+}
+
+TEST_F(TestSerialization, VectorOfPair) {
+    std::vector<std::pair<int, float>> input{{1, .5}, {-3, 2.25}, {7, -1.}};
+    BinStream stream;
+    stream << input;
+    EXPECT_EQ(stream.size(), sizeof(size_t) + input.size() * (sizeof(int) + sizeof(float)));
+    std::vector<std::pair<int, float>> output;
+    stream >> output;
+    EXPECT_EQ(stream.size(), 0);
+    EXPECT_EQ(output, input);
+}
+
+TEST_F(TestSerialization, VectorOfPaddedPair) {
+    std::vector<std::pair<int, double>> input{{1, .5}, {-3, 2.25}};
+    BinStream stream;
+    stream << input;
+    EXPECT_EQ(stream.size(), sizeof(size_t) + input.size() * (sizeof(int) + sizeof(double)));
+    std::vector<std::pair<int, double>> output;
+    stream >> output;
+    EXPECT_EQ(output, input);
+}
+
+TEST_F(TestSerialization, VectorWithStreamOperator) {
+    std::vector<TestSerializationWithStreamOperator> input{TestSerializationWithStreamOperator(3),
+                                                           TestSerializationWithStreamOperator(-4)};
+    BinStream stream;
+    stream << input;
+    // Elements still go through the user-defined operator
+    EXPECT_EQ(stream.size(), sizeof(size_t) + input.size() * sizeof(int64_t));
+    std::vector<TestSerializationWithStreamOperator> output;
+    stream >> output;
+    ASSERT_EQ(output.size(), input.size());
+    for (int i = 0; i < output.size(); i++)
+        EXPECT_EQ(output[i].x, input[i].x);
+}
+
+TEST_F(TestSerialization, Range) {
+    std::vector<std::pair<int, float>> input{{1, .5}, {2, 1.5}};
+    BinStream stream;
+    base::serialize_range(stream, input.data(), input.size());
+    // No length prefix, and the layout matches element-wise serialization
+    EXPECT_EQ(stream.size(), input.size() * (sizeof(int) + sizeof(float)));
+    int key;
+    float msg;
+    stream >> key >> msg;
+    EXPECT_EQ(key, 1);
+    EXPECT_FLOAT_EQ(msg, .5);
+    std::pair<int, float> rest;
+    base::deserialize_range(stream, &rest, 1);
+    EXPECT_EQ(rest, input[1]);
+}
+
 TEST_F(TestSerialization, VectorBool) {
     std::vector<bool> input{1, 0, 1};
     BinStream stream;
@@ -228,6 +310,219 @@ TEST_F(TestSerialization, OtherBinStream) {
     EXPECT_STREQ(s.c_str(), ss.c_str());
 }
 
+TEST_F(TestSerialization, View) {
+    BinStream input;
+    input << 1 << std::string("abc") << 2.0;
+    auto owner = std::make_shared<std::vector<char>>(input.get_buffer_vector());
+
+    BinStream view = BinStream::view(owner->data(), owner->size(), owner);
+    EXPECT_TRUE(view.is_view());
+    EXPECT_EQ(view.size(), input.size());
+    EXPECT_EQ(view.get_remained_buffer(), owner->data());
+    int a;
+    std::string b;
+    view >> a >> b;
+    EXPECT_EQ(a, 1);
+    EXPECT_EQ(b, "abc");
+
+    // Copies and moves keep viewing the same bytes
+    BinStream copy(view);
+    BinStream moved(std::move(view));
+    EXPECT_TRUE(moved.is_view());
+    EXPECT_EQ(copy.get_remained_buffer(), moved.get_remained_buffer());
+    owner.reset();
+    double c;
+    moved >> c;
+    EXPECT_EQ(c, 2.0);
+
+    // Writing takes a copy of the bytes
+    copy << 3;
+    EXPECT_FALSE(copy.is_view());
+    copy >> c >> a;
+    EXPECT_EQ(c, 2.0);
+    EXPECT_EQ(a, 3);
+}
+
+TEST_F(TestSerialization, PopBackBytes) {
+    BinStream stream;
+    stream << 1 << 2 << 3;
+    int a;
+    stream >> a;
+    stream.pop_back_bytes(sizeof(int));
+    EXPECT_EQ(stream.size(), sizeof(int));
+    stream >> a;
+    EXPECT_EQ(a, 2);
+
+    auto owner = std::make_shared<std::vector<char>>(sizeof(int) * 2, 0);
+    BinStream view = BinStream::view(owner->data(), owner->size(), owner);
+    view.pop_back_bytes(sizeof(int));
+    EXPECT_TRUE(view.is_view());
+    EXPECT_EQ(view.size(), sizeof(int));
+}
+
+TEST_F(TestSerialization, StringRef) {
+    BinStream stream;
+    stream << std::string("husky") << std::string() << 1;
+    base::StringRef a, b;
+    int c;
+    stream >> a >> b >> c;
+    EXPECT_EQ(a.to_string(), "husky");
+    EXPECT_EQ(a, std::string("husky"));
+    EXPECT_LT(a, std::string("husky2"));
+    EXPECT_LT(std::string("hus"), a);
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ(c, 1);
+
+    // A StringRef is written like a std::string
+    BinStream other;
+    other << a;
+    std::string d;
+    other >> d;
+    EXPECT_EQ(d, "husky");
+}
+
+TEST_F(TestSerialization, ArrayRef) {
+    BinStream stream;
+    std::vector<double> v = {1.0, 2.0, 3.0};
+    stream << 'x' << v;
+    char x;
+    base::ArrayRef<double> ref;
+    stream >> x >> ref;
+    ASSERT_EQ(ref.size(), 3);
+    EXPECT_EQ(ref[1], 2.0);
+    EXPECT_EQ(ref.to_vector(), v);
+}
+
+enum class Color : int16_t { Red = -1, Green = 300 };
+
+TEST_F(TestSerialization, Compact) {
+    BinStream stream;
+    stream.set_compact(true);
+    std::vector<int64_t> ints = {0, 1, -1, 63, -64, 64, 300, -300, INT64_MAX, INT64_MIN};
+    std::vector<std::pair<int, uint32_t>> pairs = {{-5, 5u}, {1 << 20, UINT32_MAX}};
+    std::string str(200, 's');
+    stream << ints << pairs << str << Color::Red << Color::Green << uint8_t(255) << 2.5 << size_t(1);
+
+    std::vector<int64_t> recv_ints;
+    std::vector<std::pair<int, uint32_t>> recv_pairs;
+    std::string recv_str;
+    Color red, green;
+    uint8_t byte;
+    double d;
+    size_t one;
+    BinStream copy(stream);
+    EXPECT_TRUE(copy.is_compact());
+    copy >> recv_ints >> recv_pairs >> recv_str >> red >> green >> byte >> d >> one;
+    EXPECT_EQ(recv_ints, ints);
+    EXPECT_EQ(recv_pairs, pairs);
+    EXPECT_EQ(recv_str, str);
+    EXPECT_EQ(red, Color::Red);
+    EXPECT_EQ(green, Color::Green);
+    EXPECT_EQ(byte, 255);
+    EXPECT_EQ(d, 2.5);
+    EXPECT_EQ(one, 1);
+    EXPECT_EQ(copy.size(), 0);
+
+    // Small integers and lengths take a byte each
+    BinStream compact, full;
+    compact.set_compact(true);
+    std::vector<int> small(100, 7);
+    compact << small;
+    full << small;
+    EXPECT_EQ(compact.size(), 101);
+    EXPECT_EQ(full.size(), sizeof(size_t) + 100 * sizeof(int));
+
+    // The mode stays with the stream
+    compact.recycle();
+    EXPECT_TRUE(compact.is_compact());
+}
+
+class MacroVertex {
+   public:
+    int id = 0;
+    std::vector<int> adj;
+    float pr = 0;
+    HUSKY_SERIALIZE(MacroVertex, id, adj, pr)
+};
+
+class MacroPoint {
+   public:
+    int x = 0;
+    double y = 0;
+    char c = 0;
+    std::pair<int, int> p;
+    HUSKY_SERIALIZE(MacroPoint, x, y, c, p)
+};
+
+class MacroNested {
+   public:
+    MacroPoint point;
+    int64_t n = 0;
+    HUSKY_SERIALIZE(MacroNested, point, n)
+};
+
+TEST_F(TestSerialization, Macro) {
+    MacroVertex v;
+    v.id = 3;
+    v.adj = {1, 2, 5};
+    v.pr = 0.5;
+    BinStream stream;
+    stream << v;
+
+    // The same bytes as writing the fields one by one
+    BinStream expected;
+    expected << v.id << v.adj << v.pr;
+    EXPECT_EQ(stream.to_string(), expected.to_string());
+
+    MacroVertex recv_v;
+    stream >> recv_v;
+    EXPECT_EQ(recv_v.id, 3);
+    EXPECT_EQ(recv_v.adj, v.adj);
+    EXPECT_EQ(recv_v.pr, 0.5);
+
+    EXPECT_EQ(base::serialized_size<MacroVertex>::value, 0);
+    EXPECT_EQ(base::serialized_size<MacroPoint>::value, 2 * sizeof(int) + sizeof(double) + sizeof(char) + sizeof(int));
+    EXPECT_EQ(base::serialized_size<MacroNested>::value, base::serialized_size<MacroPoint>::value + sizeof(int64_t));
+    EXPECT_EQ(base::serialized_size<int>::value, sizeof(int));
+    EXPECT_EQ(base::serialized_size<std::string>::value, 0);
+}
+
+TEST_F(TestSerialization, MacroRange) {
+    std::vector<MacroNested> objs(10);
+    for (int i = 0; i < 10; ++i) {
+        objs[i].point.x = -i;
+        objs[i].point.y = i * 0.5;
+        objs[i].point.c = 'a' + i;
+        objs[i].point.p = {i, 2 * i};
+        objs[i].n = i * 1000000000LL;
+    }
+    for (bool compact : {false, true}) {
+        BinStream stream;
+        stream.set_compact(compact);
+        stream << objs;
+        if (!compact)
+            EXPECT_EQ(stream.size(), sizeof(size_t) + 10 * base::serialized_size<MacroNested>::value);
+        // The same bytes as writing the objects one by one
+        BinStream expected;
+        expected.set_compact(compact);
+        expected << objs.size();
+        for (auto& obj : objs)
+            expected << obj;
+        EXPECT_EQ(stream.to_string(), expected.to_string());
+        std::vector<MacroNested> recv_objs;
+        stream >> recv_objs;
+        ASSERT_EQ(recv_objs.size(), 10);
+        for (int i = 0; i < 10; ++i) {
+            EXPECT_EQ(recv_objs[i].point.x, -i);
+            EXPECT_EQ(recv_objs[i].point.y, i * 0.5);
+            EXPECT_EQ(recv_objs[i].point.c, 'a' + i);
+            EXPECT_EQ(recv_objs[i].point.p, std::make_pair(i, 2 * i));
+            EXPECT_EQ(recv_objs[i].n, i * 1000000000LL);
+        }
+        EXPECT_EQ(stream.size(), 0);
+    }
+}
+
 TEST_F(TestSerialization, Mixture) {
     bool a = true;
     std::string b = "husky";
@@ -0,0 +1,231 @@
+// Copyright 2016 Husky Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/shm_ring.hpp"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/exception.hpp"
+
+namespace husky {
+namespace base {
+
+namespace {
+
+// Spin this many times before sleeping, since the other side usually reacts within microseconds
+const int kSpinsBeforeSleep = 1024;
+
+}  // namespace
+
+ShmRing* ShmRing::create(const std::string& name, size_t capacity) {
+    // Remove the ring left by a crashed job of the same name
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1)
+        throw HuskyException("Cannot create shared memory " + name + ": " + std::strerror(errno));
+    size_t mapped_size = sizeof(Header) + capacity;
+    if (ftruncate(fd, mapped_size) == -1) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        throw HuskyException("Cannot resize shared memory " + name + ": " + std::strerror(errno));
+    }
+    void* addr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw HuskyException("Cannot map shared memory " + name + ": " + std::strerror(errno));
+    }
+
+    auto* header = new (addr) Header();
+    header->head = 0;
+    header->tail = 0;
+    header->reader_waiting = 0;
+    header->writer_waiting = 0;
+    header->closed = 0;
+    header->capacity = capacity;
+    pthread_mutexattr_t mutex_attr;
+    pthread_mutexattr_init(&mutex_attr);
+    pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&header->mutex, &mutex_attr);
+    pthread_mutexattr_destroy(&mutex_attr);
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+    pthread_cond_init(&header->cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    // Writers only use the ring after it is ready
+    header->ready.store(1, std::memory_order_release);
+    return new ShmRing(name, header, mapped_size, true);
+}
+
+ShmRing* ShmRing::open(const std::string& name) {
+    int fd;
+    while ((fd = shm_open(name.c_str(), O_RDWR, 0600)) == -1) {
+        if (errno != ENOENT)
+            throw HuskyException("Cannot open shared memory " + name + ": " + std::strerror(errno));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // The size is set by the reader right after creation
+    struct stat st;
+    do {
+        if (fstat(fd, &st) == -1) {
+            ::close(fd);
+            throw HuskyException("Cannot stat shared memory " + name + ": " + std::strerror(errno));
+        }
+        if (st.st_size < static_cast<off_t>(sizeof(Header)))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } while (st.st_size < static_cast<off_t>(sizeof(Header)));
+    void* addr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        throw HuskyException("Cannot map shared memory " + name + ": " + std::strerror(errno));
+
+    auto* header = reinterpret_cast<Header*>(addr);
+    while (header->ready.load(std::memory_order_acquire) == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return new ShmRing(name, header, st.st_size, false);
+}
+
+ShmRing::ShmRing(const std::string& name, Header* header, size_t mapped_size, bool is_reader)
+    : name_(name),
+      header_(header),
+      data_(reinterpret_cast<char*>(header) + sizeof(Header)),
+      capacity_(header->capacity),
+      mapped_size_(mapped_size),
+      is_reader_(is_reader) {}
+
+ShmRing::~ShmRing() {
+    munmap(header_, mapped_size_);
+    if (is_reader_)
+        shm_unlink(name_.c_str());
+}
+
+void ShmRing::copy_in(uint64_t pos, const char* src, size_t size) {
+    size_t offset = pos % capacity_;
+    size_t first = std::min(size, capacity_ - offset);
+    std::memcpy(data_ + offset, src, first);
+    std::memcpy(data_, src + first, size - first);
+}
+
+void ShmRing::copy_out(uint64_t pos, char* dst, size_t size) {
+    size_t offset = pos % capacity_;
+    size_t first = std::min(size, capacity_ - offset);
+    std::memcpy(dst, data_ + offset, first);
+    std::memcpy(dst + first, data_, size - first);
+}
+
+template <typename Pred>
+void ShmRing::wait(std::atomic<int>& waiting, Pred pred) {
+    for (int i = 0; i < kSpinsBeforeSleep; ++i) {
+        if (pred())
+            return;
+        std::this_thread::yield();
+    }
+    pthread_mutex_lock(&header_->mutex);
+    // Publish the waiting flag before checking, so the other side either updates before the check or signals
+    waiting = 1;
+    while (!pred())
+        pthread_cond_wait(&header_->cond, &header_->mutex);
+    waiting = 0;
+    pthread_mutex_unlock(&header_->mutex);
+}
+
+void ShmRing::signal(std::atomic<int>& waiting) {
+    if (waiting == 0)
+        return;
+    pthread_mutex_lock(&header_->mutex);
+    pthread_cond_broadcast(&header_->cond);
+    pthread_mutex_unlock(&header_->mutex);
+}
+
+void ShmRing::write(const char* head, size_t head_size, const char* body, size_t body_size) {
+    size_t size = head_size + body_size;
+    size_t written = 0;
+    uint64_t pos = header_->head.load(std::memory_order_relaxed);
+    do {
+        // Wait for room for a chunk of a reasonable size, so that a large message is not cut into tiny chunks
+        size_t min_chunk = std::min(size - written, capacity_ / 4);
+        wait(header_->writer_waiting, [&]() {
+            return capacity_ - (pos - header_->tail.load()) >= sizeof(Chunk) + min_chunk;
+        });
+        size_t room = capacity_ - (pos - header_->tail.load()) - sizeof(Chunk);
+        Chunk chunk;
+        chunk.size = std::min(size - written, std::min(room, static_cast<size_t>(UINT32_MAX)));
+        chunk.last = written + chunk.size == size;
+        copy_in(pos, reinterpret_cast<const char*>(&chunk), sizeof(Chunk));
+        pos += sizeof(Chunk);
+        // The chunk may cover the end of head and the start of body
+        size_t end = written + chunk.size;
+        if (written < head_size) {
+            size_t n = std::min(end, head_size) - written;
+            copy_in(pos, head + written, n);
+            pos += n;
+            written += n;
+        }
+        if (written < end) {
+            size_t n = end - written;
+            copy_in(pos, body + (written - head_size), n);
+            pos += n;
+            written += n;
+        }
+        header_->head.store(pos);
+        signal(header_->reader_waiting);
+    } while (written < size);
+}
+
+bool ShmRing::read(std::vector<char>* message) {
+    message->clear();
+    uint64_t pos = header_->tail.load(std::memory_order_relaxed);
+    while (true) {
+        wait(header_->reader_waiting,
+             [&]() { return header_->head.load() != pos || header_->closed; });
+        if (header_->head.load() == pos)
+            return false;
+        Chunk chunk;
+        copy_out(pos, reinterpret_cast<char*>(&chunk), sizeof(Chunk));
+        pos += sizeof(Chunk);
+        size_t size = message->size();
+        message->resize(size + chunk.size);
+        copy_out(pos, message->data() + size, chunk.size);
+        pos += chunk.size;
+        header_->tail.store(pos);
+        signal(header_->writer_waiting);
+        if (chunk.last)
+            return true;
+    }
+}
+
+void ShmRing::close() {
+    pthread_mutex_lock(&header_->mutex);
+    header_->closed = 1;
+    pthread_cond_broadcast(&header_->cond);
+    pthread_mutex_unlock(&header_->mutex);
+}
+
+}  // namespace base
+}  // namespace husky
@@ -0,0 +1,96 @@
+// Copyright 2016 Husky Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <pthread.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace husky {
+namespace base {
+
+/// A single-producer single-consumer message queue in POSIX shared memory, for processes on the same host.
+///
+/// The reader creates the ring, and the writer opens it by name, waiting for the reader if needed. Messages
+/// are written in chunks, so a message may be larger than the ring. Neither side makes a system call while
+/// the other keeps up: they only sleep on a process-shared condition variable when the ring is empty (for
+/// the reader) or full (for the writer), and the other side only signals it when it sleeps.
+class ShmRing {
+   public:
+    /// Create the ring `name` (such as "/husky-ring") of `capacity` bytes for reading
+    static ShmRing* create(const std::string& name, size_t capacity);
+    /// Open the ring `name` for writing, waiting until its reader creates it
+    static ShmRing* open(const std::string& name);
+
+    /// Unmap the ring. The reader also removes the name of the ring.
+    ~ShmRing();
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    /// Write a message made of `head` followed by `body`, blocking while the ring is full
+    void write(const char* head, size_t head_size, const char* body, size_t body_size);
+    /// Replace `message` with the next message, blocking while the ring is empty.
+    /// Return false once the ring is closed and all the messages have been read.
+    bool read(std::vector<char>* message);
+    /// Wake up the reader and make it return false once it has read everything
+    void close();
+
+    inline const std::string& get_name() const { return name_; }
+    inline size_t get_capacity() const { return capacity_; }
+
+   protected:
+    struct Header {
+        std::atomic<uint64_t> head;  // Bytes written so far, only updated by the writer
+        std::atomic<uint64_t> tail;  // Bytes read so far, only updated by the reader
+        std::atomic<int> reader_waiting;
+        std::atomic<int> writer_waiting;
+        std::atomic<int> closed;
+        std::atomic<int> ready;
+        uint64_t capacity;
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+    };
+
+    // The header of each chunk of a message
+    struct Chunk {
+        uint32_t size;
+        uint32_t last;
+    };
+
+    ShmRing(const std::string& name, Header* header, size_t mapped_size, bool is_reader);
+
+    void copy_in(uint64_t pos, const char* src, size_t size);
+    void copy_out(uint64_t pos, char* dst, size_t size);
+    // Block until the predicate holds, marking the side as waiting so that the other side signals it
+    template <typename Pred>
+    void wait(std::atomic<int>& waiting, Pred pred);
+    // Wake up the other side if it waits
+    void signal(std::atomic<int>& waiting);
+
+    std::string name_;
+    Header* header_;
+    char* data_;
+    size_t capacity_;
+    size_t mapped_size_;
+    bool is_reader_;
+};
+
+}  // namespace base
+}  // namespace husky
@@ -0,0 +1,83 @@
+#include "base/shm_ring.hpp"
+
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace husky {
+namespace {
+
+using base::ShmRing;
+
+class TestShmRing : public testing::Test {
+   public:
+    TestShmRing() {}
+    ~TestShmRing() {}
+
+   protected:
+    void SetUp() { name = "/husky-test-shm-ring-" + std::to_string(getpid()); }
+    void TearDown() {}
+
+    std::string name;
+};
+
+TEST_F(TestShmRing, WriteAndRead) {
+    std::unique_ptr<ShmRing> reader(ShmRing::create(name, 1024));
+    std::unique_ptr<ShmRing> writer(ShmRing::open(name));
+    EXPECT_EQ(writer->get_capacity(), 1024);
+
+    std::string head = "head";
+    std::string body = "body";
+    writer->write(head.data(), head.size(), body.data(), body.size());
+    writer->write(head.data(), head.size(), nullptr, 0);
+    std::vector<char> message;
+    ASSERT_TRUE(reader->read(&message));
+    EXPECT_EQ(std::string(message.begin(), message.end()), "headbody");
+    ASSERT_TRUE(reader->read(&message));
+    EXPECT_EQ(std::string(message.begin(), message.end()), "head");
+
+    reader->close();
+    EXPECT_FALSE(reader->read(&message));
+}
+
+TEST_F(TestShmRing, LargerThanRing) {
+    std::unique_ptr<ShmRing> reader(ShmRing::create(name, 256));
+    const int kNumMessages = 100;
+    std::thread writer_thread([this]() {
+        std::unique_ptr<ShmRing> writer(ShmRing::open(name));
+        for (int i = 0; i < kNumMessages; ++i) {
+            std::vector<int> body(i * 10, i);
+            writer->write(reinterpret_cast<const char*>(&i), sizeof(int), reinterpret_cast<const char*>(body.data()),
+                          body.size() * sizeof(int));
+        }
+    });
+
+    std::vector<char> message;
+    for (int i = 0; i < kNumMessages; ++i) {
+        ASSERT_TRUE(reader->read(&message));
+        ASSERT_EQ(message.size(), (i * 10 + 1) * sizeof(int));
+        const int* ints = reinterpret_cast<const int*>(message.data());
+        for (int j = 0; j <= i * 10; ++j)
+            EXPECT_EQ(ints[j], i);
+    }
+    writer_thread.join();
+}
+
+TEST_F(TestShmRing, OpenBeforeCreate) {
+    std::unique_ptr<ShmRing> writer;
+    std::thread writer_thread([this, &writer]() { writer.reset(ShmRing::open(name)); });
+    std::unique_ptr<ShmRing> reader(ShmRing::create(name, 1024));
+    writer_thread.join();
+    writer->write("a", 1, nullptr, 0);
+    std::vector<char> message;
+    ASSERT_TRUE(reader->read(&message));
+    EXPECT_EQ(message[0], 'a');
+}
+
+}  // namespace
+}  // namespace husky
@@ -30,14 +30,7 @@ class Vertex {
     const KeyT& id() const { return vertexId; }
 
     // Serialization and deserialization
-    friend husky::BinStream& operator<<(husky::BinStream& stream, const Vertex& u) {
-        stream << u.vertexId << u.adj << u.pr;
-        return stream;
-    }
-    friend husky::BinStream& operator>>(husky::BinStream& stream, Vertex& u) {
-        stream >> u.vertexId >> u.adj >> u.pr;
-        return stream;
-    }
+    HUSKY_SERIALIZE(Vertex, vertexId, adj, pr)
 
     int vertexId;
     std::vector<int> adj;
@@ -100,6 +100,48 @@ if(WITHOUT_MONGODB)
     message(STATUS "Not using MongoClient due to WITHOUT_MONGODB option")
 endif(WITHOUT_MONGODB)
 
+### LZ4 ###
+
+find_path(LZ4_INCLUDE_DIR NAMES lz4.h)
+find_library(LZ4_LIBRARY NAMES lz4)
+if(LZ4_INCLUDE_DIR AND LZ4_LIBRARY)
+    set(LZ4_FOUND true)
+endif(LZ4_INCLUDE_DIR AND LZ4_LIBRARY)
+if(LZ4_FOUND)
+    set(LZ4_DEFINITION "-DWITH_LZ4")
+    message (STATUS "Found LZ4:")
+    message (STATUS "  (Headers)       ${LZ4_INCLUDE_DIR}")
+    message (STATUS "  (Library)       ${LZ4_LIBRARY}")
+    message (STATUS "  (Definition)    ${LZ4_DEFINITION}")
+else(LZ4_FOUND)
+    message (STATUS "Could NOT find LZ4")
+endif(LZ4_FOUND)
+if(WITHOUT_LZ4)
+    unset(LZ4_FOUND)
+    message(STATUS "Not using LZ4 due to WITHOUT_LZ4 option")
+endif(WITHOUT_LZ4)
+
+### Zstd ###
+
+find_path(ZSTD_INCLUDE_DIR NAMES zstd.h)
+find_library(ZSTD_LIBRARY NAMES zstd)
+if(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+    set(ZSTD_FOUND true)
+endif(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+if(ZSTD_FOUND)
+    set(ZSTD_DEFINITION "-DWITH_ZSTD")
+    message (STATUS "Found Zstd:")
+    message (STATUS "  (Headers)       ${ZSTD_INCLUDE_DIR}")
+    message (STATUS "  (Library)       ${ZSTD_LIBRARY}")
+    message (STATUS "  (Definition)    ${ZSTD_DEFINITION}")
+else(ZSTD_FOUND)
+    message (STATUS "Could NOT find Zstd")
+endif(ZSTD_FOUND)
+if(WITHOUT_ZSTD)
+    unset(ZSTD_FOUND)
+    message(STATUS "Not using Zstd due to WITHOUT_ZSTD option")
+endif(WITHOUT_ZSTD)
+
 ### RT ###
 
 find_library(RT_LIBRARY NAMES rt)
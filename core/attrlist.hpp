@@ -46,6 +46,7 @@ class AttrListBase {
     virtual void move(const size_t dest, const size_t src) = 0;
     virtual void migrate(BinStream& bin, const size_t idx) = 0;
     virtual void process_bin(BinStream& bin, const size_t idx) = 0;
+    virtual void process_bin(BinStream& bin, const size_t idx, const size_t num) = 0;
 
     template <typename ObjT>
     friend class ObjList;
@@ -179,6 +180,13 @@ class AttrList : public AttrListBase {
         this->set(idx, std::move(attr));
     }
 
+    // Read the attributes of `num` objects starting from idx, which are serialized contiguously
+    void process_bin(BinStream& bin, const size_t idx, const size_t num) override {
+        if (data_.size() < idx + num)
+            data_.resize(idx + num, default_val_);
+        base::deserialize_range(bin, data_.data() + idx, num);
+    }
+
     std::vector<AttrT> data_;
     AttrT default_val_;
     ObjListData<ObjT>* master_data_ptr_;
@@ -45,6 +45,7 @@ class AsyncMigrateChannel : public MigrateChannel<ObjT> {
     /// This method is only useful without list_execute
     void out() override {
         // No increment progress id here
+        this->pack_migrate_buffer();
         int start = this->global_id_;
         for (int i = 0; i < this->migrate_buffer_.size(); ++i) {
             int dst = (start + i) % this->migrate_buffer_.size();
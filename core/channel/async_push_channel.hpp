@@ -14,12 +14,16 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <functional>
 #include <vector>
 
 #include "base/serialization.hpp"
 #include "core/channel/channel_impl.hpp"
 #include "core/channel/push_channel.hpp"
+#include "core/constants.hpp"
 #include "core/hash_ring.hpp"
 #include "core/mailbox.hpp"
 #include "core/objlist.hpp"
@@ -42,28 +46,208 @@ class AsyncPushChannel : public PushChannel<MsgT, ObjT> {
     AsyncPushChannel(AsyncPushChannel&&) = default;
     AsyncPushChannel& operator=(AsyncPushChannel&&) = default;
 
+    void customized_setup() override {
+        PushChannel<MsgT, ObjT>::customized_setup();
+        unacked_bytes_.resize(this->worker_info_->get_largest_tid() + 1, 0);
+        owed_acks_.resize(this->worker_info_->get_largest_tid() + 1, 0);
+        unacked_since_.resize(this->worker_info_->get_largest_tid() + 1);
+    }
+
+    void push(const MsgT& msg, const typename ObjT::KeyT& key) {
+        int dst_worker_id = this->dst_ptr_->lookup_partition(key, this->worker_info_->get_hash_ring());
+        if (!this->may_exist(key, dst_worker_id))
+            return;
+        this->send_buffer_[dst_worker_id] << key << msg;
+        if (max_flush_latency_ == 0.0)
+            return;
+        if (!has_pending_) {
+            pending_since_ = std::chrono::steady_clock::now();
+            has_pending_ = true;
+        }
+        if (this->send_buffer_[dst_worker_id].size() >= get_batch_bytes() && is_window_open(dst_worker_id))
+            send_buffer(dst_worker_id);
+        // Reading the clock on every push is too costly
+        if ((++num_pushes_ & 63) == 0 && std::chrono::steady_clock::now() - pending_since_ > max_latency())
+            out();
+    }
+
+    /// \brief Flush during the pass over the list rather than only after it
+    ///
+    /// A destination is flushed in push() once its buffer reaches the batch size, and all buffers are flushed
+    /// once the oldest buffered message has waited `max_latency` seconds, so messages of a long pass leave early
+    /// while short passes do not flood the event loop with tiny BinStreams. If `batch_bytes` is 0, the batch size
+    /// is tuned to the bytes this worker sends to a destination within the max latency. With flow control, the
+    /// max latency is raised to the measured round trip, since flushing more often only queues behind the window.
+    ///
+    /// @param max_latency Seconds a message may wait in the buffer, 0 to flush only in out()
+    /// @param batch_bytes Bytes to buffer for a destination before sending them, 0 to tune it automatically
+    void set_adaptive_flush(double max_latency, size_t batch_bytes = 0) {
+        max_flush_latency_ = max_latency;
+        batch_bytes_ = batch_bytes;
+        has_pending_ = false;
+        num_pushes_ = 0;
+        last_tune_ = std::chrono::steady_clock::now();
+    }
+
+    /// The batch size in bytes used by adaptive flush
+    size_t get_batch_bytes() const { return batch_bytes_ != 0 ? batch_bytes_ : tuned_batch_bytes_; }
+
+    /// \brief Bound the bytes in flight from this worker to each destination
+    ///
+    /// Once `window` bytes sent to a destination are not yet acknowledged, out() stops sending to it and
+    /// keeps coalescing its messages until the receiver catches up. Receivers acknowledge the bytes they
+    /// have processed in their next out(). Senders never block, so two workers flooding each other cannot
+    /// deadlock. All workers must use the same setting.
+    ///
+    /// @param window Bytes in flight to each destination, 0 to disable flow control
+    void set_flow_control(size_t window) { flow_control_window_ = window; }
+
+    /// Bytes sent to a destination which are not yet acknowledged by it
+    size_t get_unacked_bytes(int dst) const { return unacked_bytes_[dst]; }
+
+    void in(BinStream& bin) override {
+        if (flow_control_window_ == 0) {
+            this->process_bin(bin);
+            return;
+        }
+        // Strip the trailer (sender, kind) and keep the read position of the payload. The trailer and the ack
+        // payload are raw bytes, so they read the same whether the stream is compact or not.
+        size_t bin_size = bin.size();
+        int sender, kind;
+        std::memcpy(&sender, bin.get_remained_buffer() + bin_size - 2 * sizeof(int), sizeof(int));
+        std::memcpy(&kind, bin.get_remained_buffer() + bin_size - sizeof(int), sizeof(int));
+        bin.pop_back_bytes(2 * sizeof(int));
+
+        if (kind == kAck) {
+            size_t acked_bytes;
+            std::memcpy(&acked_bytes, bin.pop_front_bytes(sizeof(size_t)), sizeof(size_t));
+            unacked_bytes_[sender] -= acked_bytes;
+            if (unacked_bytes_[sender] == 0)
+                update_round_trip(std::chrono::steady_clock::now() - unacked_since_[sender]);
+        } else {
+            this->process_bin(bin);
+            owed_acks_[sender] += bin_size;
+        }
+    }
+
     void out() override {
         // No increment progress id here
+        if (flow_control_window_ != 0)
+            send_acks();
         int start = this->global_id_;
         for (int i = 0; i < this->send_buffer_.size(); ++i) {
             int dst = (start + i) % this->send_buffer_.size();
             if (this->send_buffer_[dst].size() == 0)
                 continue;
-            this->mailbox_->send(dst, this->channel_id_, this->progress_, this->send_buffer_[dst]);
-            this->send_buffer_[dst].purge();
+            if (!is_window_open(dst))
+                continue;
+            send_buffer(dst);
         }
+        if (max_flush_latency_ != 0.0)
+            tune_batch_bytes();
         // No send_complete here
     }
 
+    /// Send all the buffered messages regardless of the flow control window, e.g., before send_complete
+    void send() override {
+        for (int i = 0; i < this->send_buffer_.size(); ++i)
+            if (this->send_buffer_[i].size() != 0)
+                send_buffer(i);
+    }
+
     // This is for unittest only
     void prepare_messages_test() {
         this->clear_recv_buffer_();
         while (this->mailbox_->poll_with_timeout(this->channel_id_, this->progress_, 1.0)) {
             auto bin_push = this->mailbox_->recv(this->channel_id_, this->progress_);
-            this->process_bin(bin_push);
+            in(bin_push);
         }
         this->reset_flushed();
     }
+
+   protected:
+    enum FlowControlMessage : int { kData = 0, kAck = 1 };
+
+    void send_buffer(int dst) {
+        auto& buffer = this->send_buffer_[dst];
+        if (flow_control_window_ != 0) {
+            push_back_trailer(buffer, kData);
+            if (unacked_bytes_[dst] == 0)
+                unacked_since_[dst] = std::chrono::steady_clock::now();
+            unacked_bytes_[dst] += buffer.size();
+        }
+        size_t bytes = buffer.size();
+        bytes_since_tune_ += bytes;
+        this->mailbox_->send(dst, this->channel_id_, this->progress_, buffer);
+        buffer.purge();
+        buffer.reserve(bytes);
+    }
+
+    void send_acks() {
+        for (int i = 0; i < owed_acks_.size(); ++i) {
+            if (owed_acks_[i] == 0)
+                continue;
+            BinStream ack;
+            ack.push_back_bytes(reinterpret_cast<const char*>(&owed_acks_[i]), sizeof(size_t));
+            push_back_trailer(ack, kAck);
+            this->mailbox_->send(i, this->channel_id_, this->progress_, ack);
+            owed_acks_[i] = 0;
+        }
+    }
+
+    // Append (sender, kind) as fixed-width bytes, since in() reads them off the end of the stream
+    void push_back_trailer(BinStream& bin, FlowControlMessage kind) const {
+        int trailer[2] = {static_cast<int>(this->global_id_), static_cast<int>(kind)};
+        bin.push_back_bytes(reinterpret_cast<const char*>(trailer), sizeof(trailer));
+    }
+
+    bool is_window_open(int dst) const {
+        return flow_control_window_ == 0 || unacked_bytes_[dst] < flow_control_window_;
+    }
+
+    std::chrono::duration<double> max_latency() const {
+        return std::chrono::duration<double>(std::max(max_flush_latency_, round_trip_));
+    }
+
+    void update_round_trip(std::chrono::duration<double> sample) {
+        round_trip_ = round_trip_ == 0.0 ? sample.count() : 0.8 * round_trip_ + 0.2 * sample.count();
+    }
+
+    // Batch size = sending throughput per destination * max latency, smoothed across flushes
+    void tune_batch_bytes() {
+        has_pending_ = false;
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - last_tune_).count();
+        if (elapsed <= 0.0)
+            return;
+        double throughput = bytes_since_tune_ / elapsed;
+        throughput_ = throughput_ == 0.0 ? throughput : 0.8 * throughput_ + 0.2 * throughput;
+        bytes_since_tune_ = 0;
+        last_tune_ = now;
+        double batch = throughput_ * max_latency().count() / this->send_buffer_.size();
+        tuned_batch_bytes_ =
+            std::min(std::max(static_cast<size_t>(batch), ASYNC_MIN_BATCH_BYTES), ASYNC_MAX_BATCH_BYTES);
+    }
+
+    size_t flow_control_window_ = 0;
+    std::vector<size_t> unacked_bytes_;
+    // Bytes received from each sender which are not yet acknowledged
+    std::vector<size_t> owed_acks_;
+    // When the oldest unacknowledged bytes to each destination were sent
+    std::vector<std::chrono::steady_clock::time_point> unacked_since_;
+    double round_trip_ = 0.0;
+
+    // Adaptive flush
+    double max_flush_latency_ = 0.0;
+    size_t batch_bytes_ = 0;
+    size_t tuned_batch_bytes_ = ASYNC_MIN_BATCH_BYTES;
+    bool has_pending_ = false;
+    std::chrono::steady_clock::time_point pending_since_;
+    size_t num_pushes_ = 0;
+    // Sending throughput (bytes/second) measured between flushes
+    double throughput_ = 0.0;
+    size_t bytes_since_tune_ = 0;
+    std::chrono::steady_clock::time_point last_tune_;
 };
 
 }  // namespace husky
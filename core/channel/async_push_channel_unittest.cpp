@@ -1,5 +1,6 @@
 #include "core/channel/async_push_channel.hpp"
 
+#include <chrono>
 #include <string>
 #include <thread>
 #include <vector>
@@ -9,6 +10,7 @@
 #include "base/log.hpp"
 #include "base/serialization.hpp"
 #include "core/channel/migrate_channel.hpp"
+#include "core/constants.hpp"
 #include "core/hash_ring.hpp"
 #include "core/mailbox.hpp"
 #include "core/objlist.hpp"
@@ -196,6 +198,156 @@ TEST_F(TestAsyncPushChannel, IncProgress) {
     EXPECT_EQ(msgs[0], 456);
 }
 
+TEST_F(TestAsyncPushChannel, FlowControl) {
+    // On a thread of its own, which numbers its channels from 0
+    std::thread([&]() {
+        // Mailbox Setup
+        zmq::context_t zmq_context;
+        MailboxEventLoop el(&zmq_context);
+        el.set_process_id(0);
+        CentralRecver recver(&zmq_context, "inproc://test");
+        LocalMailbox mailbox(&zmq_context);
+        mailbox.set_thread_id(0);
+        el.register_mailbox(mailbox);
+
+        // WorkerInfo Setup
+        WorkerInfo workerinfo;
+        workerinfo.add_worker(0, 0, 0);
+        workerinfo.set_process_id(0);
+
+        // ObjList Setup
+        ObjList<Obj> obj_list;
+
+        // PushChannel with a window of one message
+        auto async_push_channel = create_async_push_channel<int>(obj_list);
+        async_push_channel.setup(0, 0, workerinfo, &mailbox);
+        async_push_channel.set_flow_control(1);
+        async_push_channel.push(123, 10);
+        async_push_channel.out();
+        EXPECT_GT(async_push_channel.get_unacked_bytes(0), 0);
+        size_t unacked_bytes = async_push_channel.get_unacked_bytes(0);
+
+        // The window is full, so the next messages are held back and coalesced
+        async_push_channel.push(456, 10);
+        async_push_channel.out();
+        async_push_channel.push(789, 10);
+        async_push_channel.out();
+        EXPECT_EQ(async_push_channel.get_unacked_bytes(0), unacked_bytes);
+        async_push_channel.prepare_messages_test();
+        Obj& obj = obj_list.get_data()[0];
+        EXPECT_EQ(async_push_channel.get(obj).size(), 1);
+        EXPECT_EQ(async_push_channel.get(obj)[0], 123);
+
+        // Processing the message acknowledges it in out(), which opens the window again
+        async_push_channel.out();
+        async_push_channel.prepare_messages_test();
+        EXPECT_EQ(async_push_channel.get_unacked_bytes(0), 0);
+        async_push_channel.out();
+        async_push_channel.prepare_messages_test();
+        auto msgs = async_push_channel.get(obj);
+        EXPECT_EQ(msgs.size(), 2);
+        EXPECT_EQ(msgs[0], 456);
+        EXPECT_EQ(msgs[1], 789);
+
+        // send() ignores the window
+        async_push_channel.push(1, 10);
+        async_push_channel.out();
+        async_push_channel.push(2, 10);
+        async_push_channel.send();
+        async_push_channel.prepare_messages_test();
+        EXPECT_EQ(async_push_channel.get(obj).size(), 2);
+    }).join();
+}
+
+TEST_F(TestAsyncPushChannel, FlowControlCompact) {
+    // On a thread of its own, which numbers its channels from 0
+    std::thread([&]() {
+        // Mailbox Setup
+        zmq::context_t zmq_context;
+        MailboxEventLoop el(&zmq_context);
+        el.set_process_id(0);
+        CentralRecver recver(&zmq_context, "inproc://test");
+        LocalMailbox mailbox(&zmq_context);
+        mailbox.set_thread_id(0);
+        el.register_mailbox(mailbox);
+
+        // WorkerInfo Setup
+        WorkerInfo workerinfo;
+        workerinfo.add_worker(0, 0, 0);
+        workerinfo.set_process_id(0);
+
+        // ObjList Setup
+        ObjList<Obj> obj_list;
+
+        // The trailer and the acks must survive compact streams
+        auto async_push_channel = create_async_push_channel<int>(obj_list);
+        async_push_channel.setup(0, 0, workerinfo, &mailbox);
+        async_push_channel.set_compact_serialization(true);
+        async_push_channel.set_flow_control(1);
+        async_push_channel.push(123, 10);
+        async_push_channel.out();
+        EXPECT_GT(async_push_channel.get_unacked_bytes(0), 0);
+        async_push_channel.push(456, 10);
+        async_push_channel.out();
+        async_push_channel.prepare_messages_test();
+        Obj& obj = obj_list.get_data()[0];
+        ASSERT_EQ(async_push_channel.get(obj).size(), 1);
+        EXPECT_EQ(async_push_channel.get(obj)[0], 123);
+
+        async_push_channel.out();
+        async_push_channel.prepare_messages_test();
+        EXPECT_EQ(async_push_channel.get_unacked_bytes(0), 0);
+        async_push_channel.out();
+        async_push_channel.prepare_messages_test();
+        ASSERT_EQ(async_push_channel.get(obj).size(), 1);
+        EXPECT_EQ(async_push_channel.get(obj)[0], 456);
+    }).join();
+}
+
+TEST_F(TestAsyncPushChannel, AdaptiveFlush) {
+    // On a thread of its own, which numbers its channels from 0
+    std::thread([&]() {
+        // Mailbox Setup
+        zmq::context_t zmq_context;
+        MailboxEventLoop el(&zmq_context);
+        el.set_process_id(0);
+        CentralRecver recver(&zmq_context, "inproc://test");
+        LocalMailbox mailbox(&zmq_context);
+        mailbox.set_thread_id(0);
+        el.register_mailbox(mailbox);
+
+        // WorkerInfo Setup
+        WorkerInfo workerinfo;
+        workerinfo.add_worker(0, 0, 0);
+        workerinfo.set_process_id(0);
+
+        // ObjList Setup
+        ObjList<Obj> obj_list;
+
+        auto async_push_channel = create_async_push_channel<int>(obj_list);
+        async_push_channel.setup(0, 0, workerinfo, &mailbox);
+        async_push_channel.set_adaptive_flush(0.001);
+        EXPECT_EQ(async_push_channel.get_batch_bytes(), ASYNC_MIN_BATCH_BYTES);
+
+        // Flush by size: two key-message pairs fill a batch
+        async_push_channel.set_adaptive_flush(100.0, 2 * (sizeof(int) + sizeof(int)));
+        async_push_channel.push(123, 10);
+        async_push_channel.push(456, 10);
+        async_push_channel.prepare_messages_test();
+        Obj& obj = obj_list.get_data()[0];
+        EXPECT_EQ(async_push_channel.get(obj).size(), 2);
+
+        // Flush by time: the clock is checked every 64 pushes
+        async_push_channel.set_adaptive_flush(0.001, 1 << 20);
+        for (int i = 0; i < 63; ++i)
+            async_push_channel.push(i, 10);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        async_push_channel.push(63, 10);
+        async_push_channel.prepare_messages_test();
+        EXPECT_EQ(async_push_channel.get(obj).size(), 64);
+    }).join();
+}
+
 TEST_F(TestAsyncPushChannel, MultiThread) {
     // Mailbox Setup
     zmq::context_t zmq_context;
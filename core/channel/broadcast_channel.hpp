@@ -14,7 +14,16 @@
 
 #pragma once
 
+#include <algorithm>
+#include <deque>
 #include <functional>
+#include <list>
+#include <map>
+#include <set>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "base/serialization.hpp"
@@ -31,6 +40,51 @@ namespace husky {
 
 using base::BinStream;
 
+namespace detail {
+
+// Whether `a == b` compiles for T. The standard containers and pairs declare operator== whatever their elements
+// are, and only fail to compile when it is instantiated, so they are checked by their elements instead.
+template <typename T>
+class has_equal_operator {
+    template <typename U>
+    static auto check(int) -> decltype(std::declval<const U&>() == std::declval<const U&>(), std::true_type());
+
+    template <typename>
+    static std::false_type check(...);
+
+   public:
+    static const bool value = decltype(check<T>(0))::value;
+};
+
+template <typename T1, typename T2>
+class has_equal_operator<std::pair<T1, T2>> {
+   public:
+    static const bool value = has_equal_operator<T1>::value && has_equal_operator<T2>::value;
+};
+
+template <typename T, typename Alloc>
+class has_equal_operator<std::vector<T, Alloc>> : public has_equal_operator<T> {};
+
+template <typename T, typename Alloc>
+class has_equal_operator<std::deque<T, Alloc>> : public has_equal_operator<T> {};
+
+template <typename T, typename Alloc>
+class has_equal_operator<std::list<T, Alloc>> : public has_equal_operator<T> {};
+
+template <typename T, typename Compare, typename Alloc>
+class has_equal_operator<std::set<T, Compare, Alloc>> : public has_equal_operator<T> {};
+
+template <typename T, typename Hash, typename Pred, typename Alloc>
+class has_equal_operator<std::unordered_set<T, Hash, Pred, Alloc>> : public has_equal_operator<T> {};
+
+template <typename K, typename V, typename Compare, typename Alloc>
+class has_equal_operator<std::map<K, V, Compare, Alloc>> : public has_equal_operator<std::pair<K, V>> {};
+
+template <typename K, typename V, typename Hash, typename Pred, typename Alloc>
+class has_equal_operator<std::unordered_map<K, V, Hash, Pred, Alloc>> : public has_equal_operator<std::pair<K, V>> {};
+
+}  // namespace detail
+
 template <typename KeyT, typename ValueT>
 class BroadcastChannel : public ChannelBase {
    public:
@@ -57,9 +111,20 @@ class BroadcastChannel : public ChannelBase {
         broadcast_buffer_.resize(worker_info_->get_largest_tid() + 1);
         accessor_ = AccessorStore::create_accessor<std::unordered_map<KeyT, ValueT>>(
             channel_id_, local_id_, worker_info_->get_num_local_workers());
+        // Ranks of the processes in the broadcast tree, which must agree on all processes
+        tree_pids_ = worker_info_->get_pids();
+        std::sort(tree_pids_.begin(), tree_pids_.end());
+        tree_rank_ = std::find(tree_pids_.begin(), tree_pids_.end(), worker_info_->get_process_id()) -
+                     tree_pids_.begin();
     }
 
     void broadcast(const KeyT& key, const ValueT& value) {
+        if (delta_broadcast_ && !update_sent_value(key, value))
+            return;
+        if (tree_fanout_ > 0) {
+            tree_broadcast(key, value);
+            return;
+        }
         for (int i = 0; i < worker_info_->get_num_processes(); ++i) {
             int recv_proc_num_worker = worker_info_->get_num_local_workers(i);
             int recver_local_id_ = std::hash<KeyT>()(key) % recv_proc_num_worker;
@@ -90,7 +155,42 @@ class BroadcastChannel : public ChannelBase {
         return iter != dict.end();
     }
 
-    void set_clear_dict(bool clear) { clear_dict_each_progress_ = clear; }
+    void set_clear_dict(bool clear) {
+        ASSERT_MSG(!(clear && delta_broadcast_), "Delta broadcast needs the dict to be kept across progress");
+        clear_dict_each_progress_ = clear;
+    }
+
+    /// \brief Only send the key-value pairs whose values changed since they were last broadcast
+    ///
+    /// The sender remembers the last value it broadcast for each key and drops a broadcast whose value
+    /// is equal to it, so receivers only patch the changed entries of the dict they keep across progress.
+    /// The remembered values are a copy of everything the worker broadcast, so large tables take twice the
+    /// memory on the sender. Values without operator==, including the containers of elements without it,
+    /// are always treated as changed and not remembered. Each key should be broadcast by a single worker,
+    /// or an entry overwritten by another worker may not be restored.
+    /// Disabling delta broadcast forgets the remembered values.
+    void set_delta_broadcast(bool delta) {
+        ASSERT_MSG(!(delta && clear_dict_each_progress_), "Delta broadcast needs the dict to be kept across progress");
+        delta_broadcast_ = delta;
+        if (!delta)
+            std::unordered_map<KeyT, ValueT>().swap(sent_values_);
+    }
+
+    /// \brief Forward broadcast data along a tree of processes instead of sending it to every process
+    ///
+    /// Each key-value pair travels along a tree rooted at the process of its sender, in which every
+    /// process forwards the pair to at most `fanout` children. A sender thus writes O(fanout) copies
+    /// instead of one per process, at the cost of one mailbox round per tree level in flush().
+    /// A fanout of 1 forms a chain. All workers must use the same setting.
+    ///
+    /// @param fanout Number of children of each process in the tree
+    void set_tree_broadcast(int fanout = 2) {
+        ASSERT_MSG(fanout > 0, "The fanout of the broadcast tree should be positive");
+        tree_fanout_ = fanout;
+    }
+
+    /// Send broadcast data directly to every process. This is the default.
+    void set_direct_broadcast() { tree_fanout_ = 0; }
 
     void prepare() override {}
 
@@ -103,17 +203,12 @@ class BroadcastChannel : public ChannelBase {
 
     /// This method is only useful without list_execute
     void flush() {
-        this->inc_progress();
-        int start = global_id_;
-        for (int i = 0; i < broadcast_buffer_.size(); ++i) {
-            int dst = (start + i) % broadcast_buffer_.size();
-            if (broadcast_buffer_[dst].size() == 0)
-                continue;
-            mailbox_->send(dst, channel_id_, progress_, broadcast_buffer_[dst]);
-            broadcast_buffer_[dst].purge();
+        if (tree_fanout_ > 0) {
+            tree_flush();
+            return;
         }
-        this->mailbox_->send_complete(this->channel_id_, this->progress_, this->worker_info_->get_local_tids(),
-                                      this->worker_info_->get_pids());
+        this->inc_progress();
+        send_broadcast_buffer();
     }
 
     /// This method is only useful without list_execute
@@ -124,9 +219,16 @@ class BroadcastChannel : public ChannelBase {
         need_leave_accessor_ = true;
 
         auto& local_dict = (*accessor_)[local_id_].storage();
-        while (mailbox_->poll(channel_id_, progress_)) {
-            auto bin = mailbox_->recv(channel_id_, progress_);
-            process_bin(bin, local_dict);
+        if (tree_fanout_ > 0) {
+            // The tree rounds in flush() have already received everything
+            for (auto& kv : tree_recv_buffer_)
+                local_dict[kv.first] = std::move(kv.second);
+            tree_recv_buffer_.clear();
+        } else {
+            while (mailbox_->poll(channel_id_, progress_)) {
+                auto bin = mailbox_->recv(channel_id_, progress_);
+                process_bin(bin, local_dict);
+            }
         }
         (*accessor_)[local_id_].commit();
     }
@@ -153,10 +255,119 @@ class BroadcastChannel : public ChannelBase {
         }
     }
 
+    // Return whether the value of the key differs from the one last broadcast, and remember it if so
+    template <typename V = ValueT>
+    typename std::enable_if<detail::has_equal_operator<V>::value, bool>::type update_sent_value(const KeyT& key,
+                                                                                                const V& value) {
+        auto iter = sent_values_.find(key);
+        if (iter == sent_values_.end()) {
+            sent_values_.emplace(key, value);
+            return true;
+        }
+        if (iter->second == value)
+            return false;
+        iter->second = value;
+        return true;
+    }
+
+    // Values which cannot be compared always count as changed, so they are not remembered
+    template <typename V = ValueT>
+    typename std::enable_if<!detail::has_equal_operator<V>::value, bool>::type update_sent_value(const KeyT& key,
+                                                                                                 const V& value) {
+        return true;
+    }
+
+    void send_broadcast_buffer() {
+        int start = global_id_;
+        for (int i = 0; i < broadcast_buffer_.size(); ++i) {
+            int dst = (start + i) % broadcast_buffer_.size();
+            if (broadcast_buffer_[dst].size() == 0)
+                continue;
+            mailbox_->send(dst, channel_id_, progress_, broadcast_buffer_[dst]);
+            broadcast_buffer_[dst].purge();
+        }
+        this->mailbox_->send_complete(this->channel_id_, this->progress_, this->worker_info_->get_local_tids(),
+                                      this->worker_info_->get_pids());
+    }
+
+    // In tree mode a record in broadcast_buffer_ is (rank of the root process, key, value).
+    // The root sends each record to the worker holding its key on the root process and on the
+    // root's children. Those children forward the record to their own children in the next round.
+    void tree_broadcast(const KeyT& key, const ValueT& value) {
+        BinStream record;
+        record << tree_rank_ << key << value;
+        size_t key_hash = std::hash<KeyT>()(key);
+        broadcast_buffer_[tree_recver_id(tree_rank_, key_hash)].append(record);
+        forward_to_children(0, key_hash, record);
+    }
+
+    void forward_to_children(int relative_rank, size_t key_hash, const BinStream& record) {
+        int num_ranks = tree_pids_.size();
+        for (int i = 1; i <= tree_fanout_; ++i) {
+            int child = relative_rank * tree_fanout_ + i;
+            if (child >= num_ranks)
+                break;
+            broadcast_buffer_[tree_recver_id((tree_rank_ + child - relative_rank + num_ranks) % num_ranks, key_hash)]
+                .append(record);
+        }
+    }
+
+    void tree_flush() {
+        // One round for each level of the tree, and at least one for the delivery inside the root process
+        int num_rounds = std::max(tree_depth(tree_pids_.size() - 1), 1);
+        for (int round = 0; round < num_rounds; ++round) {
+            this->inc_progress();
+            send_broadcast_buffer();
+            while (mailbox_->poll(channel_id_, progress_)) {
+                auto bin = mailbox_->recv(channel_id_, progress_);
+                process_tree_bin(bin);
+            }
+        }
+    }
+
+    void process_tree_bin(BinStream& bin) {
+        int num_ranks = tree_pids_.size();
+        while (bin.size() != 0) {
+            const char* record_begin = bin.get_remained_buffer();
+            int root;
+            KeyT key;
+            ValueT value;
+            bin >> root >> key >> value;
+            int relative_rank = (tree_rank_ - root + num_ranks) % num_ranks;
+            // The root has already sent the record to its children
+            if (relative_rank != 0) {
+                BinStream record(record_begin, bin.get_remained_buffer() - record_begin);
+                forward_to_children(relative_rank, std::hash<KeyT>()(key), record);
+            }
+            tree_recv_buffer_.emplace_back(std::move(key), std::move(value));
+        }
+    }
+
+    int tree_recver_id(int rank, size_t key_hash) {
+        int pid = tree_pids_[rank];
+        return worker_info_->local_to_global_id(pid, key_hash % worker_info_->get_num_local_workers(pid));
+    }
+
+    int tree_depth(int relative_rank) {
+        int depth = 0;
+        while (relative_rank > 0) {
+            relative_rank = (relative_rank - 1) / tree_fanout_;
+            depth += 1;
+        }
+        return depth;
+    }
+
     ChannelSource* src_ptr_;
 
     bool clear_dict_each_progress_ = false;
     bool need_leave_accessor_ = false;
+    bool delta_broadcast_ = false;
+    // The last broadcast value of each key in delta broadcast, if the values can be compared
+    std::unordered_map<KeyT, ValueT> sent_values_;
+    int tree_fanout_ = 0;
+    int tree_rank_ = 0;
+    std::vector<int> tree_pids_;
+    std::vector<std::pair<KeyT, ValueT>> tree_recv_buffer_;
     std::vector<BinStream> broadcast_buffer_;
     std::vector<Accessor<std::unordered_map<KeyT, ValueT>>>* accessor_;
 };
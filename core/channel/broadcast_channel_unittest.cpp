@@ -2,6 +2,9 @@
 
 #include <iostream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -34,6 +37,22 @@ class Obj {
     explicit Obj(const KeyT& k) : key(k) {}
 };
 
+// A value without operator==
+struct NoEqual {
+    int x = 0;
+};
+
+BinStream& operator<<(BinStream& stream, const NoEqual& v) { return stream << v.x; }
+BinStream& operator>>(BinStream& stream, NoEqual& v) { return stream >> v.x; }
+
+// Expose the values remembered for delta broadcast
+template <typename KeyT, typename ValueT>
+class TestableBroadcastChannel : public BroadcastChannel<KeyT, ValueT> {
+   public:
+    explicit TestableBroadcastChannel(ChannelSource* src) : BroadcastChannel<KeyT, ValueT>(src) {}
+    size_t get_num_sent_values() const { return this->sent_values_.size(); }
+};
+
 // Create broadcast without setting
 template <typename KeyT, typename ValueT>
 BroadcastChannel<KeyT, ValueT> create_broadcast_channel(ChannelSource& src_list) {
@@ -171,6 +190,162 @@ TEST_F(TestBroadcastChannel, BroadcastClearDict) {
     EXPECT_EQ(broadcast_channel.find(23), false);  // Last round result is invalid
 }
 
+TEST_F(TestBroadcastChannel, DeltaBroadcast) {
+    // On a thread of its own, which numbers its channels from 0
+    std::thread([&]() {
+        // HashRing Setup
+        HashRing hashring;
+        hashring.insert(0, 0);
+
+        // Mailbox Setup
+        zmq::context_t zmq_context;
+        MailboxEventLoop el(&zmq_context);
+        el.set_process_id(0);
+        CentralRecver recver(&zmq_context, "inproc://test");
+        LocalMailbox mailbox(&zmq_context);
+        mailbox.set_thread_id(0);
+        el.register_mailbox(mailbox);
+
+        // WorkerInfo Setup
+        WorkerInfo workerinfo;
+        workerinfo.add_worker(0, 0, 0);
+        workerinfo.set_process_id(0);
+
+        // ObjList Setup
+        ObjList<Obj> src_list;
+
+        // BroadcastChannel
+        auto broadcast_channel = create_broadcast_channel<int, std::string>(src_list);
+        broadcast_channel.set_delta_broadcast(true);
+        broadcast_channel.setup(0, 0, workerinfo, &mailbox);
+
+        // Round 1
+        broadcast_channel.broadcast(23, "abc");
+        broadcast_channel.broadcast(45, "bbb");
+        broadcast_channel.flush();
+
+        broadcast_channel.prepare_broadcast();
+        EXPECT_EQ(broadcast_channel.get(23), "abc");
+        EXPECT_EQ(broadcast_channel.get(45), "bbb");
+
+        // Round 2: nothing changed so nothing is sent
+        broadcast_channel.broadcast(23, "abc");
+        broadcast_channel.broadcast(45, "bbb");
+        broadcast_channel.flush();
+        EXPECT_FALSE(mailbox.poll(broadcast_channel.get_channel_id(), broadcast_channel.get_progress()));
+
+        broadcast_channel.prepare_broadcast();
+        EXPECT_EQ(broadcast_channel.get(23), "abc");
+        EXPECT_EQ(broadcast_channel.get(45), "bbb");
+
+        // Round 3: only the changed entry is patched
+        broadcast_channel.broadcast(23, "abc");
+        broadcast_channel.broadcast(45, "b");
+        broadcast_channel.flush();
+
+        broadcast_channel.prepare_broadcast();
+        EXPECT_EQ(broadcast_channel.get(23), "abc");
+        EXPECT_EQ(broadcast_channel.get(45), "b");
+    }).join();
+}
+
+TEST_F(TestBroadcastChannel, DeltaBroadcastWithoutEqual) {
+    // On a thread of its own, which numbers its channels from 0
+    std::thread([&]() {
+        EXPECT_TRUE((detail::has_equal_operator<std::vector<std::pair<int, std::string>>>::value));
+        EXPECT_FALSE(detail::has_equal_operator<NoEqual>::value);
+        EXPECT_FALSE(detail::has_equal_operator<std::vector<NoEqual>>::value);
+        EXPECT_FALSE((detail::has_equal_operator<std::pair<int, NoEqual>>::value));
+        EXPECT_FALSE((detail::has_equal_operator<std::unordered_map<int, std::vector<NoEqual>>>::value));
+
+        // HashRing Setup
+        HashRing hashring;
+        hashring.insert(0, 0);
+
+        // Mailbox Setup
+        zmq::context_t zmq_context;
+        MailboxEventLoop el(&zmq_context);
+        el.set_process_id(0);
+        CentralRecver recver(&zmq_context, "inproc://test");
+        LocalMailbox mailbox(&zmq_context);
+        mailbox.set_thread_id(0);
+        el.register_mailbox(mailbox);
+
+        // WorkerInfo Setup
+        WorkerInfo workerinfo;
+        workerinfo.add_worker(0, 0, 0);
+        workerinfo.set_process_id(0);
+
+        // ObjList Setup
+        ObjList<Obj> src_list;
+
+        // BroadcastChannel
+        TestableBroadcastChannel<int, std::vector<NoEqual>> broadcast_channel(&src_list);
+        broadcast_channel.set_delta_broadcast(true);
+        broadcast_channel.setup(0, 0, workerinfo, &mailbox);
+
+        // The values cannot be compared, so they are sent in every round
+        for (int round = 0; round < 2; ++round) {
+            broadcast_channel.broadcast(23, std::vector<NoEqual>(2));
+            broadcast_channel.flush();
+            EXPECT_TRUE(mailbox.poll(broadcast_channel.get_channel_id(), broadcast_channel.get_progress()));
+
+            broadcast_channel.prepare_broadcast();
+            EXPECT_EQ(broadcast_channel.get(23).size(), 2);
+        }
+        // Nothing is kept for the comparison
+        EXPECT_EQ(broadcast_channel.get_num_sent_values(), 0);
+    }).join();
+}
+
+TEST_F(TestBroadcastChannel, TreeBroadcast) {
+    // On a thread of its own, which numbers its channels from 0
+    std::thread([&]() {
+        // HashRing Setup
+        HashRing hashring;
+        hashring.insert(0, 0);
+
+        // Mailbox Setup
+        zmq::context_t zmq_context;
+        MailboxEventLoop el(&zmq_context);
+        el.set_process_id(0);
+        CentralRecver recver(&zmq_context, "inproc://test");
+        LocalMailbox mailbox(&zmq_context);
+        mailbox.set_thread_id(0);
+        el.register_mailbox(mailbox);
+
+        // WorkerInfo Setup
+        WorkerInfo workerinfo;
+        workerinfo.add_worker(0, 0, 0);
+        workerinfo.set_process_id(0);
+
+        // ObjList Setup
+        ObjList<Obj> src_list;
+
+        // BroadcastChannel
+        auto broadcast_channel = create_broadcast_channel<int, std::string>(src_list);
+        broadcast_channel.set_tree_broadcast(1);
+        broadcast_channel.setup(0, 0, workerinfo, &mailbox);
+
+        // Round 1
+        broadcast_channel.broadcast(23, "abc");
+        broadcast_channel.broadcast(45, "bbb");
+        broadcast_channel.flush();
+
+        broadcast_channel.prepare_broadcast();
+        EXPECT_EQ(broadcast_channel.get(23), "abc");
+        EXPECT_EQ(broadcast_channel.get(45), "bbb");
+
+        // Round 2
+        broadcast_channel.broadcast(23, "a");
+        broadcast_channel.flush();
+
+        broadcast_channel.prepare_broadcast();
+        EXPECT_EQ(broadcast_channel.get(23), "a");
+        EXPECT_EQ(broadcast_channel.get(45), "bbb");
+    }).join();
+}
+
 TEST_F(TestBroadcastChannel, MultiThread) {
     // HashRing Setup
     HashRing hashring;
@@ -236,5 +411,72 @@ TEST_F(TestBroadcastChannel, MultiThread) {
     th2.join();
 }
 
+TEST_F(TestBroadcastChannel, TreeBroadcastMultiThread) {
+    // HashRing Setup
+    HashRing hashring;
+    hashring.insert(0, 0);
+    hashring.insert(1, 0);
+
+    // Mailbox Setup
+    zmq::context_t zmq_context;
+    MailboxEventLoop el(&zmq_context);
+    el.set_process_id(0);
+    CentralRecver recver(&zmq_context, "inproc://test");
+    // Mailbox_0
+    LocalMailbox mailbox_0(&zmq_context);
+    mailbox_0.set_thread_id(0);
+    el.register_mailbox(mailbox_0);
+    // Mailbox_1
+    LocalMailbox mailbox_1(&zmq_context);
+    mailbox_1.set_thread_id(1);
+    el.register_mailbox(mailbox_1);
+
+    // WorkerInfo Setup
+    WorkerInfo workerinfo;
+    workerinfo.add_worker(0, 0, 0);
+    workerinfo.add_worker(0, 1, 1);
+    workerinfo.set_process_id(0);
+
+    std::thread th1 = std::thread([&]() {
+        // ObjList Setup
+        ObjList<Obj> src_list;
+
+        // BroacastChannel
+        auto broadcast_channel = create_broadcast_channel<int, std::string>(src_list);
+        broadcast_channel.set_tree_broadcast();
+        broadcast_channel.setup(0, 0, workerinfo, &mailbox_0);
+
+        // broadcast
+        // Round 1
+        broadcast_channel.broadcast(23, "abc");
+        broadcast_channel.flush();
+
+        broadcast_channel.prepare_broadcast();
+        EXPECT_EQ(broadcast_channel.get(23), "abc");
+        EXPECT_EQ(broadcast_channel.get(12), "ddd");
+    });
+    std::thread th2 = std::thread([&]() {
+        // ObjList Setup
+        ObjList<Obj> src_list;
+
+        // BroacastChannel
+        auto broadcast_channel = create_broadcast_channel<int, std::string>(src_list);
+        broadcast_channel.set_tree_broadcast();
+        broadcast_channel.setup(1, 1, workerinfo, &mailbox_1);
+
+        // broadcast
+        // Round 1
+        broadcast_channel.broadcast(12, "ddd");
+        broadcast_channel.flush();
+
+        broadcast_channel.prepare_broadcast();
+        EXPECT_EQ(broadcast_channel.get(23), "abc");
+        EXPECT_EQ(broadcast_channel.get(12), "ddd");
+    });
+
+    th1.join();
+    th2.join();
+}
+
 }  // namespace
 }  // namespace husky
@@ -14,6 +14,7 @@
 
 #include "core/channel/channel_base.hpp"
 
+#include "base/assert.hpp"
 #include "core/hash_ring.hpp"
 #include "core/mailbox.hpp"
 #include "core/worker_info.hpp"
@@ -39,6 +40,17 @@ void ChannelBase::set_as_async_channel() { type_ = ChannelType::Async; }
 
 void ChannelBase::set_as_sync_channel() { type_ = ChannelType::Sync; }
 
+void ChannelBase::set_compression(base::CompressionCodec codec, size_t min_bytes) {
+    ASSERT_MSG(mailbox_ != nullptr, "Set up the channel before setting its compression");
+    mailbox_->set_compression(channel_id_, codec, min_bytes);
+}
+
+void ChannelBase::set_compact_serialization(bool compact) {
+    ASSERT_MSG(mailbox_ != nullptr, "Set up the channel before setting its serialization");
+    mailbox_->set_compact_serialization(channel_id_, compact);
+    set_compact_buffers(compact);
+}
+
 void ChannelBase::setup(size_t local_id, size_t global_id, const WorkerInfo& worker_info, LocalMailbox* mailbox) {
     set_local_id(local_id);
     set_global_id(global_id);
@@ -17,6 +17,7 @@
 #include <cstdlib>
 #include <vector>
 
+#include "base/compression.hpp"
 #include "base/serialization.hpp"
 #include "core/hash_ring.hpp"
 #include "core/mailbox.hpp"
@@ -34,6 +35,7 @@ class ChannelBase {
 
     /// Getter
     inline static size_t get_num_channel() { return s_counter; }
+
     inline LocalMailbox* get_mailbox() const { return mailbox_; }
     inline size_t get_channel_id() const { return channel_id_; }
     inline size_t get_global_id() const { return global_id_; }
@@ -50,6 +52,14 @@ class ChannelBase {
     void set_as_async_channel();
     void set_as_sync_channel();
 
+    /// Compress the BinStreams of this channel to other hosts if they have at least `min_bytes` bytes.
+    /// Every worker must set the same codec after the channel is set up. See LocalMailbox::set_compression.
+    void set_compression(base::CompressionCodec codec, size_t min_bytes = 4096);
+
+    /// Write and read the BinStreams of this channel as compact streams, which encode integers as varints.
+    /// Every worker must set the same mode after the channel is set up. See BinStream::set_compact.
+    void set_compact_serialization(bool compact);
+
     void setup(size_t local_id, size_t global_id, const WorkerInfo& worker_info, LocalMailbox* mailbox);
 
     /// customized_setup() is used to do customized setup for subclass
@@ -84,6 +94,9 @@ class ChannelBase {
    protected:
     ChannelBase();
 
+    /// Set the mode of the BinStreams which the subclass writes to, for set_compact_serialization()
+    virtual void set_compact_buffers(bool compact) {}
+
     ChannelBase(const ChannelBase&) = delete;
     ChannelBase& operator=(const ChannelBase&) = delete;
 
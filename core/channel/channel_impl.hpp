@@ -14,6 +14,12 @@
 
 #pragma once
 
+#include <functional>
+#include <vector>
+
+#include "base/assert.hpp"
+#include "base/bloom_filter.hpp"
+#include "base/serialization.hpp"
 #include "core/channel/channel_base.hpp"
 #include "core/channel/channel_source.hpp"
 #include "core/objlist.hpp"
@@ -22,6 +28,52 @@ namespace husky {
 
 template <typename DstObjT>
 class Source2ObjListChannel : public ChannelBase {
+   public:
+    /// \brief Build Bloom filters of the keys in the destination ObjList and exchange them among workers
+    ///
+    /// Afterwards, push() drops the messages whose keys are not in the filter of their destination worker,
+    /// and receivers drop the few false positives instead of creating objects for them. It is a collective
+    /// operation taking one progress of the channel, so all workers must invoke it when no pushed messages
+    /// are pending. Objects added to the destination ObjList later are dropped until the filters are rebuilt.
+    ///
+    /// @param bits_per_key Bits of each filter per key. 10 bits give a false positive rate of about 1%.
+    void build_key_filter(double bits_per_key = 10) {
+        ASSERT_MSG(!this->is_flushed(), "The pushed messages should be received before building the key filter");
+        base::BloomFilter local_filter(dst_ptr_->get_size(), bits_per_key);
+        for (size_t i = 0; i < dst_ptr_->get_vector_size(); ++i)
+            if (!dst_ptr_->get_del(i))
+                local_filter.insert(std::hash<typename DstObjT::KeyT>()(dst_ptr_->get(i).id()));
+
+        this->inc_progress();
+        BinStream bin;
+        bin << static_cast<int>(this->global_id_) << local_filter;
+        for (int tid : this->worker_info_->get_global_tids()) {
+            BinStream copy(bin.get_remained_buffer(), bin.size());
+            this->mailbox_->send(tid, this->channel_id_, this->progress_, copy);
+        }
+        this->mailbox_->send_complete(this->channel_id_, this->progress_, this->worker_info_->get_local_tids(),
+                                      this->worker_info_->get_pids());
+        key_filters_.clear();
+        key_filters_.resize(this->worker_info_->get_largest_tid() + 1);
+        while (this->mailbox_->poll(this->channel_id_, this->progress_)) {
+            auto recv_bin = this->mailbox_->recv(this->channel_id_, this->progress_);
+            int owner;
+            recv_bin >> owner;
+            recv_bin >> key_filters_[owner];
+        }
+        this->reset_flushed();
+        drop_unknown_keys_ = true;
+    }
+
+    /// Stop filtering pushed messages. Receivers keep dropping messages to unknown keys until
+    /// set_drop_unknown_keys(false) is invoked.
+    void clear_key_filter() { std::vector<base::BloomFilter>().swap(key_filters_); }
+
+    /// \brief Whether receivers drop messages to keys missing in the destination ObjList
+    ///
+    /// By default, an object is constructed from the key for each such message.
+    void set_drop_unknown_keys(bool drop) { drop_unknown_keys_ = drop; }
+
    protected:
     Source2ObjListChannel(ChannelSource* src_ptr, ObjList<DstObjT>* dst_ptr) : src_ptr_(src_ptr), dst_ptr_(dst_ptr) {}
 
@@ -33,8 +85,17 @@ class Source2ObjListChannel : public ChannelBase {
     Source2ObjListChannel(Source2ObjListChannel&&) = default;
     Source2ObjListChannel& operator=(Source2ObjListChannel&&) = default;
 
+    // Whether a message to the key on the destination worker may reach an existing object
+    inline bool may_exist(const typename DstObjT::KeyT& key, int dst_worker_id) const {
+        return key_filters_.empty() ||
+               key_filters_[dst_worker_id].may_contain(std::hash<typename DstObjT::KeyT>()(key));
+    }
+
     ChannelSource* src_ptr_ = nullptr;
     ObjList<DstObjT>* dst_ptr_ = nullptr;
+    // Bloom filters of the keys owned by each worker, built by build_key_filter()
+    std::vector<base::BloomFilter> key_filters_;
+    bool drop_unknown_keys_ = false;
 };
 
 template <typename SrcObjT, typename DstObjT>
@@ -61,6 +61,7 @@ class ChannelManager {
             ASSERT_MSG(idx != -1, "ChannelManager: Mailbox poll error");
             auto bin = mailbox_->recv(channel_progress_pairs[idx].first, channel_progress_pairs[idx].second);
             selected_channels[idx]->in(bin);
+            bin.recycle();
         }
 
         // reset the flushed_ buffer
@@ -67,6 +67,15 @@ class ChannelStore : public ChannelStoreBase {
         return ch;
     }
 
+    template <typename ValueT, typename ObjT, typename ServeT>
+    static PullChannel<typename ObjT::KeyT, ValueT>& create_pull_channel(ChannelSource& src_list,
+                                                                         ObjList<ObjT>& dst_list,
+                                                                         ServeT serve_handler) {
+        auto& ch = ChannelStoreBase::create_pull_channel<ValueT>(src_list, dst_list, serve_handler);
+        setup(ch);
+        return ch;
+    }
+
     static void setup(ChannelBase& ch) {
         ch.setup(Context::get_local_tid(), Context::get_global_tid(), Context::get_worker_info(),
                  Context::get_mailbox());
@@ -23,6 +23,7 @@
 #include "core/channel/broadcast_channel.hpp"
 #include "core/channel/channel_base.hpp"
 #include "core/channel/migrate_channel.hpp"
+#include "core/channel/pull_channel.hpp"
 #include "core/channel/push_channel.hpp"
 #include "core/channel/push_combined_channel.hpp"
 
@@ -81,6 +82,16 @@ class ChannelStoreBase {
         return *async_migrate_channel;
     }
 
+    template <typename ValueT, typename ObjT, typename ServeT>
+    static PullChannel<typename ObjT::KeyT, ValueT>& create_pull_channel(ChannelSource& src_list,
+                                                                         ObjList<ObjT>& dst_list,
+                                                                         ServeT serve_handler) {
+        ChannelMap& channel_map = get_channel_map();
+        auto* pull_channel = new PullChannel<typename ObjT::KeyT, ValueT>(&src_list, &dst_list, serve_handler);
+        channel_map.insert({pull_channel->get_channel_id(), pull_channel});
+        return *pull_channel;
+    }
+
     static bool has_channel(const size_t id);
     static void drop_channel(const size_t id);
     static void drop_all_channels();
@@ -1,5 +1,7 @@
 #include "core/channel/channel_store_base.hpp"
 
+#include <thread>
+
 #include "gtest/gtest.h"
 
 #include "core/combiner.hpp"
@@ -111,6 +113,31 @@ TEST_F(TestChannelStoreBase, CreateBroacastChannel) {
     EXPECT_EQ(ChannelStoreBase::size(), 0);
 }
 
+TEST_F(TestChannelStoreBase, CreatePullChannel) {
+    // On a thread of its own, which numbers its channels from 0
+    std::thread([&]() {
+        ObjList<Obj> src_list;
+        ObjList<Obj> dst_list;
+        auto serve = [](Obj& obj) { return obj.id(); };
+
+        auto& ch1 = ChannelStoreBase::create_pull_channel<int>(src_list, dst_list, serve);
+        size_t ch1_id = ch1.get_channel_id();
+        EXPECT_TRUE(ChannelStoreBase::has_channel(ch1_id));
+        EXPECT_EQ(ChannelStoreBase::size(), 1);
+        auto& ch2 = ChannelStoreBase::create_pull_channel<int>(src_list, dst_list, serve);
+        size_t ch2_id = ch2.get_channel_id();
+        EXPECT_TRUE(ChannelStoreBase::has_channel(ch2_id));
+        EXPECT_EQ(ChannelStoreBase::size(), 2);
+
+        ChannelStoreBase::drop_channel(ch2_id);
+        EXPECT_FALSE(ChannelStoreBase::has_channel(ch2_id));
+        EXPECT_EQ(ChannelStoreBase::size(), 1);
+        ChannelStoreBase::drop_channel(ch1_id);
+        EXPECT_FALSE(ChannelStoreBase::has_channel(ch1_id));
+        EXPECT_EQ(ChannelStoreBase::size(), 0);
+    }).join();
+}
+
 TEST_F(TestChannelStoreBase, CreateAsyncPushChannel) {
     ObjList<Obj> src_list;
 
@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <cstring>
 #include <functional>
 #include <vector>
 
@@ -47,12 +48,23 @@ class MigrateChannel : public ObjList2ObjListChannel<ObjT, ObjT> {
     MigrateChannel(MigrateChannel&&) = default;
     MigrateChannel& operator=(MigrateChannel&&) = default;
 
-    void customized_setup() override { migrate_buffer_.resize(this->worker_info_->get_largest_tid() + 1); }
+    void customized_setup() override {
+        migrate_buffer_.resize(this->worker_info_->get_largest_tid() + 1);
+        attr_buffer_.resize(this->worker_info_->get_largest_tid() + 1);
+        num_migrants_.resize(this->worker_info_->get_largest_tid() + 1, 0);
+    }
 
+    /// Objects migrated to the same thread are sent as a batch: the number of objects, the objects, and then
+    /// one column for each AttrList. The receiver appends trivially copyable objects and attributes slab by slab.
     void migrate(ObjT& obj, int dst_thread_id) {
         auto idx = this->src_ptr_->delete_object(&obj);
-        migrate_buffer_[dst_thread_id] << obj;
-        this->src_ptr_->migrate_attribute(migrate_buffer_[dst_thread_id], idx);
+        auto& buffer = migrate_buffer_[dst_thread_id];
+        // Placeholder for the number of objects in the batch, which is not a varint even in compact streams
+        if (num_migrants_[dst_thread_id] == 0)
+            buffer.push_back_bytes(reinterpret_cast<const char*>(&num_migrants_[dst_thread_id]), sizeof(size_t));
+        buffer << obj;
+        this->src_ptr_->migrate_attribute(attr_buffer_[dst_thread_id], idx, buffer.is_compact());
+        num_migrants_[dst_thread_id] += 1;
     }
 
     void prepare() override {}
@@ -64,13 +76,17 @@ class MigrateChannel : public ObjList2ObjListChannel<ObjT, ObjT> {
     /// This method is only useful without list_execute
     void flush() {
         this->inc_progress();
+        pack_migrate_buffer();
         int start = this->global_id_;
         for (int i = 0; i < migrate_buffer_.size(); ++i) {
             int dst = (start + i) % migrate_buffer_.size();
             if (migrate_buffer_[dst].size() == 0)
                 continue;
+            size_t bytes = migrate_buffer_[dst].size();
             this->mailbox_->send(dst, this->channel_id_, this->progress_, migrate_buffer_[dst]);
             migrate_buffer_[dst].purge();
+            // Expect as many bytes to the destination in the next round
+            migrate_buffer_[dst].reserve(bytes);
         }
         this->mailbox_->send_complete(this->channel_id_, this->progress_, this->worker_info_->get_local_tids(),
                                       this->worker_info_->get_pids());
@@ -84,6 +100,7 @@ class MigrateChannel : public ObjList2ObjListChannel<ObjT, ObjT> {
         while (this->mailbox_->poll(this->channel_id_, this->progress_)) {
             auto bin_push = this->mailbox_->recv(this->channel_id_, this->progress_);
             process_bin(bin_push);
+            bin_push.recycle();
         }
         // TODO(yuzhen): Should I put sort here or other place
         // object insertion finalize
@@ -92,18 +109,42 @@ class MigrateChannel : public ObjList2ObjListChannel<ObjT, ObjT> {
     }
 
    protected:
+    void set_compact_buffers(bool compact) override {
+        for (auto& buffer : migrate_buffer_)
+            buffer.set_compact(compact);
+        for (auto& columns : attr_buffer_)
+            for (auto& column : columns)
+                column.set_compact(compact);
+    }
+
+    // Complete the batches in migrate_buffer_ with the number of objects and the attribute columns
+    void pack_migrate_buffer() {
+        for (int i = 0; i < migrate_buffer_.size(); ++i) {
+            if (num_migrants_[i] == 0)
+                continue;
+            std::memcpy(migrate_buffer_[i].get_buffer(), &num_migrants_[i], sizeof(size_t));
+            for (auto& column : attr_buffer_[i]) {
+                migrate_buffer_[i].append(column);
+                column.purge();
+            }
+            num_migrants_[i] = 0;
+        }
+    }
+
     void process_bin(BinStream& bin_push) {
         while (bin_push.size() != 0) {
-            ObjT obj;
-            bin_push >> obj;
-            auto idx = this->dst_ptr_->add_object(std::move(obj));
-            this->dst_ptr_->process_attribute(bin_push, idx);
+            size_t num_objs;
+            std::memcpy(&num_objs, bin_push.pop_front_bytes(sizeof(size_t)), sizeof(size_t));
+            auto idx = this->dst_ptr_->process_objects(bin_push, num_objs);
+            this->dst_ptr_->process_attribute(bin_push, idx, num_objs);
         }
         if (this->dst_ptr_->get_num_del() * 2 > this->dst_ptr_->get_vector_size())
             this->dst_ptr_->deletion_finalize();
     }
 
     std::vector<BinStream> migrate_buffer_;
+    std::vector<std::vector<BinStream>> attr_buffer_;
+    std::vector<size_t> num_migrants_;
 };
 
 }  // namespace husky
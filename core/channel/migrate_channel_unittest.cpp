@@ -1,6 +1,7 @@
 #include "core/channel/migrate_channel.hpp"
 
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -190,6 +191,124 @@ TEST_F(TestMigrateChannel, MigrateItself) {
     EXPECT_STREQ(dst_attr.get(obj).str.c_str(), "18");
 }
 
+TEST_F(TestMigrateChannel, MigrateBatch) {
+    // On a thread of its own, which numbers its channels from 0
+    std::thread([&]() {
+        // HashRing Setup
+        HashRing hashring;
+        hashring.insert(0, 0);
+
+        // Mailbox Setup
+        zmq::context_t zmq_context;
+        MailboxEventLoop el(&zmq_context);
+        el.set_process_id(0);
+        CentralRecver recver(&zmq_context, "inproc://test");
+        LocalMailbox mailbox(&zmq_context);
+        mailbox.set_thread_id(0);
+        el.register_mailbox(mailbox);
+
+        // WorkerInfo Setup
+        WorkerInfo workerinfo;
+        workerinfo.add_worker(0, 0, 0);
+        workerinfo.set_process_id(0);
+
+        // ObjList Setup
+        ObjList<Obj> src_list;
+        ObjList<Obj> dst_list;
+        auto& src_int = src_list.create_attrlist<int>("int");
+        auto& src_double = src_list.create_attrlist<double>("double");
+        auto& src_attr = src_list.create_attrlist<Attr>("attr");
+        dst_list.create_attrlist<int>("int");
+        dst_list.create_attrlist<double>("double");
+        dst_list.create_attrlist<Attr>("attr");
+        dst_list.add_object(Obj(1));
+
+        for (int i = 0; i < 100; ++i) {
+            auto idx = src_list.add_object(Obj(i));
+            src_int.set(idx, i);
+            src_double.set(idx, i * 0.5);
+            src_attr.set(idx, Attr(std::to_string(i)));
+        }
+
+        // MigrateChannel
+        auto migrate_channel = create_migrate_channel(src_list, dst_list);
+        migrate_channel.setup(0, 0, workerinfo, &mailbox);
+        // migrate the objects with odd keys as a batch
+        for (int i = 1; i < 100; i += 2)
+            migrate_channel.migrate(*src_list.find(i), 0);
+        migrate_channel.flush();
+        migrate_channel.prepare_immigrants();
+        auto& dst_int = dst_list.get_attrlist<int>("int");
+        auto& dst_double = dst_list.get_attrlist<double>("double");
+        auto& dst_attr = dst_list.get_attrlist<Attr>("attr");
+
+        EXPECT_EQ(src_list.get_size(), 50);
+        EXPECT_EQ(dst_list.get_size(), 51);
+        for (int i = 1; i < 100; i += 2) {
+            Obj* obj = dst_list.find(i);
+            ASSERT_NE(obj, nullptr);
+            EXPECT_EQ(dst_int.get(*obj), i);
+            EXPECT_EQ(dst_double.get(*obj), i * 0.5);
+            EXPECT_EQ(dst_attr.get(*obj).str, std::to_string(i));
+        }
+    }).join();
+}
+
+TEST_F(TestMigrateChannel, MigrateCompact) {
+    // On a thread of its own, which numbers its channels from 0
+    std::thread([&]() {
+        // Mailbox Setup
+        zmq::context_t zmq_context;
+        MailboxEventLoop el(&zmq_context);
+        el.set_process_id(0);
+        CentralRecver recver(&zmq_context, "inproc://test");
+        LocalMailbox mailbox(&zmq_context);
+        mailbox.set_thread_id(0);
+        el.register_mailbox(mailbox);
+
+        // WorkerInfo Setup
+        WorkerInfo workerinfo;
+        workerinfo.add_worker(0, 0, 0);
+        workerinfo.set_process_id(0);
+
+        // ObjList Setup
+        ObjList<Obj> src_list;
+        ObjList<Obj> dst_list;
+        auto& src_int = src_list.create_attrlist<int>("int");
+        auto& src_vec = src_list.create_attrlist<std::vector<int>>("vec");
+        dst_list.create_attrlist<int>("int");
+        dst_list.create_attrlist<std::vector<int>>("vec");
+
+        for (int i = 0; i < 100; ++i) {
+            auto idx = src_list.add_object(Obj(i));
+            src_int.set(idx, -i);
+            src_vec.set(idx, std::vector<int>(i % 5, i));
+        }
+
+        // MigrateChannel with the integers in the attributes written as varints
+        auto migrate_channel = create_migrate_channel(src_list, dst_list);
+        migrate_channel.setup(0, 0, workerinfo, &mailbox);
+        migrate_channel.set_compact_serialization(true);
+        for (int round = 0; round < 2; ++round) {
+            for (int i = round; i < 100; i += 2)
+                migrate_channel.migrate(*src_list.find(i), 0);
+            migrate_channel.flush();
+            migrate_channel.prepare_immigrants();
+        }
+        auto& dst_int = dst_list.get_attrlist<int>("int");
+        auto& dst_vec = dst_list.get_attrlist<std::vector<int>>("vec");
+
+        EXPECT_EQ(src_list.get_size(), 0);
+        EXPECT_EQ(dst_list.get_size(), 100);
+        for (int i = 0; i < 100; ++i) {
+            Obj* obj = dst_list.find(i);
+            ASSERT_NE(obj, nullptr);
+            EXPECT_EQ(dst_int.get(*obj), -i);
+            EXPECT_EQ(dst_vec.get(*obj), std::vector<int>(i % 5, i));
+        }
+    }).join();
+}
+
 TEST_F(TestMigrateChannel, MigrateOtherIncProgress) {
     // HashRing Setup
     HashRing hashring;
@@ -0,0 +1,176 @@
+// Copyright 2016 Husky Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "base/assert.hpp"
+#include "base/serialization.hpp"
+#include "core/channel/channel_base.hpp"
+#include "core/channel/channel_source.hpp"
+#include "core/hash_ring.hpp"
+#include "core/mailbox.hpp"
+#include "core/objlist.hpp"
+#include "core/worker_info.hpp"
+
+namespace husky {
+
+using base::BinStream;
+
+/// PullChannel fetches values of objects owned by other workers.
+///
+/// Workers request keys with request(). Requests are deduplicated and batched for each owner, which is decided by
+/// the hash ring as in PushChannel. When the channel is flushed (at the end of list_execute), the owners look up the
+/// keys in their ObjList and answer with the values, which are then cached until the next flush.
+/// So keys requested in one list_execute can be read with get() in the next one.
+template <typename KeyT, typename ValueT>
+class PullChannel : public ChannelBase {
+   public:
+    /// @param src The source whose list_execute flushes the channel
+    /// @param dst The ObjList owning the requested objects
+    /// @param serve_handler Returns the value to answer for a requested object (ObjT&), e.g., from an AttrList
+    template <typename ObjT, typename ServeT>
+    PullChannel(ChannelSource* src, ObjList<ObjT>* dst, ServeT serve_handler) : src_ptr_(src) {
+        src_ptr_->register_outchannel(channel_id_, this);
+        serve_handler_ = [dst, serve_handler](const KeyT& key, ValueT* value) {
+            ObjT* obj = dst->find(key);
+            if (obj == nullptr)
+                return false;
+            *value = serve_handler(*obj);
+            return true;
+        };
+        // Requests follow the partitioner of dst
+        partition_handler_ = [dst](const KeyT& key, const HashRing& hash_ring) {
+            return dst->lookup_partition(key, hash_ring);
+        };
+    }
+
+    ~PullChannel() override {
+        if (src_ptr_ != nullptr)
+            src_ptr_->deregister_outchannel(channel_id_);
+    }
+
+    PullChannel(const PullChannel&) = delete;
+    PullChannel& operator=(const PullChannel&) = delete;
+
+    PullChannel(PullChannel&&) = default;
+    PullChannel& operator=(PullChannel&&) = default;
+
+    void customized_setup() override {
+        request_buffer_.resize(worker_info_->get_largest_tid() + 1);
+        reply_buffer_.resize(worker_info_->get_largest_tid() + 1);
+    }
+
+    /// Request the value of key, which can be read after the next flush
+    void request(const KeyT& key) {
+        if (!requested_keys_.insert(key).second)
+            return;
+        int dst_worker_id = partition_handler_(key, worker_info_->get_hash_ring());
+        // Each batch of requests starts with the requester
+        if (request_buffer_[dst_worker_id].size() == 0)
+            request_buffer_[dst_worker_id] << static_cast<int>(global_id_);
+        request_buffer_[dst_worker_id] << key;
+    }
+
+    /// Get the value of a key requested before the last flush
+    /// @Return false if the key was not requested or does not exist in the ObjList
+    bool get(const KeyT& key, ValueT* value) const {
+        auto iter = cache_.find(key);
+        if (iter == cache_.end())
+            return false;
+        *value = iter->second;
+        return true;
+    }
+
+    const ValueT& get(const KeyT& key) const {
+        auto iter = cache_.find(key);
+        ASSERT_MSG(iter != cache_.end(), "PullChannel::get: Key Not Found");
+        return iter->second;
+    }
+
+    bool find(const KeyT& key) const { return cache_.find(key) != cache_.end(); }
+
+    void prepare() override {}
+
+    void in(BinStream& bin) override {}
+
+    void out() override { flush(); }
+
+    /// Send the requests, serve the requests from others and cache the answers.
+    /// The answers of the last flush are dropped.
+    void flush() {
+        // Round 1: requests
+        this->inc_progress();
+        send_buffers(request_buffer_);
+        requested_keys_.clear();
+        while (mailbox_->poll(channel_id_, progress_)) {
+            auto bin = mailbox_->recv(channel_id_, progress_);
+            serve(bin);
+        }
+
+        // Round 2: answers
+        this->inc_progress();
+        send_buffers(reply_buffer_);
+        cache_.clear();
+        while (mailbox_->poll(channel_id_, progress_)) {
+            auto bin = mailbox_->recv(channel_id_, progress_);
+            while (bin.size() != 0) {
+                KeyT key;
+                ValueT value;
+                bin >> key >> value;
+                cache_[key] = std::move(value);
+            }
+        }
+    }
+
+   protected:
+    void serve(BinStream& bin) {
+        int requester;
+        bin >> requester;
+        auto& reply = reply_buffer_[requester];
+        ValueT value;
+        while (bin.size() != 0) {
+            KeyT key;
+            bin >> key;
+            if (serve_handler_(key, &value))
+                reply << key << value;
+        }
+    }
+
+    void send_buffers(std::vector<BinStream>& buffers) {
+        int start = global_id_;
+        for (int i = 0; i < buffers.size(); ++i) {
+            int dst = (start + i) % buffers.size();
+            if (buffers[dst].size() == 0)
+                continue;
+            mailbox_->send(dst, channel_id_, progress_, buffers[dst]);
+            buffers[dst].purge();
+        }
+        mailbox_->send_complete(channel_id_, progress_, worker_info_->get_local_tids(), worker_info_->get_pids());
+    }
+
+    ChannelSource* src_ptr_ = nullptr;
+    std::function<bool(const KeyT&, ValueT*)> serve_handler_;
+    std::function<int(const KeyT&, const HashRing&)> partition_handler_;
+    std::unordered_set<KeyT> requested_keys_;
+    std::unordered_map<KeyT, ValueT> cache_;
+    std::vector<BinStream> request_buffer_;
+    std::vector<BinStream> reply_buffer_;
+};
+
+}  // namespace husky
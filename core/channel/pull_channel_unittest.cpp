@@ -0,0 +1,136 @@
+#include "core/channel/pull_channel.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "base/serialization.hpp"
+#include "core/hash_ring.hpp"
+#include "core/mailbox.hpp"
+#include "core/objlist.hpp"
+#include "core/worker_info.hpp"
+
+namespace husky {
+namespace {
+
+class TestPullChannel : public testing::Test {
+   public:
+    TestPullChannel() {}
+    ~TestPullChannel() {}
+
+   protected:
+    void SetUp() {}
+    void TearDown() {}
+};
+
+class Obj {
+   public:
+    using KeyT = int;
+    KeyT key;
+    const KeyT& id() const { return key; }
+    Obj() {}
+    explicit Obj(const KeyT& k) : key(k) {}
+};
+
+TEST_F(TestPullChannel, PullFromObjList) {
+    // On a thread of its own, which numbers its channels from 0
+    std::thread([&]() {
+        // Mailbox Setup
+        zmq::context_t zmq_context;
+        MailboxEventLoop el(&zmq_context);
+        el.set_process_id(0);
+        CentralRecver recver(&zmq_context, "inproc://test");
+        LocalMailbox mailbox(&zmq_context);
+        mailbox.set_thread_id(0);
+        el.register_mailbox(mailbox);
+
+        // WorkerInfo Setup
+        WorkerInfo workerinfo;
+        workerinfo.add_worker(0, 0, 0);
+        workerinfo.set_process_id(0);
+
+        // ObjList Setup
+        ObjList<Obj> src_list;
+        ObjList<Obj> dst_list;
+        auto& dst_attr = dst_list.create_attrlist<std::string>("attr");
+        for (int i = 0; i < 10; ++i)
+            dst_attr.set(dst_list.add_object(Obj(i)), std::to_string(i));
+
+        // PullChannel
+        PullChannel<int, std::string> pull_channel(&src_list, &dst_list, [&](Obj& obj) { return dst_attr.get(obj); });
+        pull_channel.setup(0, 0, workerinfo, &mailbox);
+
+        // Round 1
+        pull_channel.request(3);
+        pull_channel.request(3);
+        pull_channel.request(7);
+        pull_channel.request(42);  // does not exist
+        pull_channel.flush();
+        EXPECT_EQ(pull_channel.get(3), "3");
+        EXPECT_EQ(pull_channel.get(7), "7");
+        std::string value;
+        EXPECT_FALSE(pull_channel.get(42, &value));
+        EXPECT_FALSE(pull_channel.find(5));
+
+        // Round 2: the answers of the last round are dropped
+        pull_channel.request(5);
+        pull_channel.flush();
+        EXPECT_TRUE(pull_channel.get(5, &value));
+        EXPECT_EQ(value, "5");
+        EXPECT_FALSE(pull_channel.find(3));
+    }).join();
+}
+
+TEST_F(TestPullChannel, MultiThread) {
+    // HashRing Setup
+    HashRing hashring;
+    hashring.insert(0, 0);
+    hashring.insert(1, 0);
+
+    // Mailbox Setup
+    zmq::context_t zmq_context;
+    MailboxEventLoop el(&zmq_context);
+    el.set_process_id(0);
+    CentralRecver recver(&zmq_context, "inproc://test");
+    LocalMailbox mailbox_0(&zmq_context);
+    mailbox_0.set_thread_id(0);
+    el.register_mailbox(mailbox_0);
+    LocalMailbox mailbox_1(&zmq_context);
+    mailbox_1.set_thread_id(1);
+    el.register_mailbox(mailbox_1);
+
+    // WorkerInfo Setup
+    WorkerInfo workerinfo;
+    workerinfo.add_worker(0, 0, 0);
+    workerinfo.add_worker(0, 1, 1);
+    workerinfo.set_process_id(0);
+
+    std::vector<LocalMailbox*> mailboxes{&mailbox_0, &mailbox_1};
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < 2; ++tid) {
+        threads.emplace_back([&, tid]() {
+            // Each thread owns the keys that the hash ring assigns to it
+            ObjList<Obj> src_list;
+            ObjList<Obj> dst_list;
+            for (int i = 0; i < 100; ++i)
+                if (workerinfo.get_hash_ring().hash_lookup(i) == tid)
+                    dst_list.add_object(Obj(i));
+
+            PullChannel<int, int> pull_channel(&src_list, &dst_list, [](Obj& obj) { return obj.id() * 2; });
+            pull_channel.setup(tid, tid, workerinfo, mailboxes[tid]);
+
+            for (int i = 0; i < 100; ++i)
+                pull_channel.request(i);
+            pull_channel.flush();
+            for (int i = 0; i < 100; ++i)
+                EXPECT_EQ(pull_channel.get(i), i * 2);
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+}
+
+}  // namespace
+}  // namespace husky
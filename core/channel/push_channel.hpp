@@ -62,7 +62,9 @@ class PushChannel : public Source2ObjListChannel<DstObjT> {
     }
 
     void push(const MsgT& msg, const typename DstObjT::KeyT& key) {
-        int dst_worker_id = this->worker_info_->get_hash_ring().hash_lookup(key);
+        int dst_worker_id = this->dst_ptr_->lookup_partition(key, this->worker_info_->get_hash_ring());
+        if (!this->may_exist(key, dst_worker_id))
+            return;
         send_buffer_[dst_worker_id] << key << msg;
     }
 
@@ -86,8 +88,11 @@ class PushChannel : public Source2ObjListChannel<DstObjT> {
             int dst = (start + i) % send_buffer_.size();
             if (send_buffer_[dst].size() == 0)
                 continue;
+            size_t bytes = send_buffer_[dst].size();
             this->mailbox_->send(dst, this->channel_id_, this->progress_ + 1, send_buffer_[dst]);
             send_buffer_[dst].purge();
+            // Expect as many bytes to the destination in the next round
+            send_buffer_[dst].reserve(bytes);
         }
     }
 
@@ -111,6 +116,7 @@ class PushChannel : public Source2ObjListChannel<DstObjT> {
         while (this->mailbox_->poll(this->channel_id_, this->progress_)) {
             auto bin_push = this->mailbox_->recv(this->channel_id_, this->progress_);
             process_bin(bin_push);
+            bin_push.recycle();
         }
         this->reset_flushed();
     }
@@ -127,6 +133,11 @@ class PushChannel : public Source2ObjListChannel<DstObjT> {
     }
 
    protected:
+    void set_compact_buffers(bool compact) override {
+        for (auto& buffer : send_buffer_)
+            buffer.set_compact(compact);
+    }
+
     void clear_recv_buffer_() {
         // TODO(yuzhen): What types of clear do we need?
         for (auto& vec : recv_buffer_)
@@ -134,14 +145,17 @@ class PushChannel : public Source2ObjListChannel<DstObjT> {
     }
     void process_bin(BinStream& bin_push) {
         while (bin_push.size() != 0) {
-            typename DstObjT::KeyT key;
+            // Look up the key without materializing it, e.g., as a base::StringRef for string keys
+            typename base::ref_type<typename DstObjT::KeyT>::type key;
             bin_push >> key;
             MsgT msg;
             bin_push >> msg;
 
             DstObjT* recver_obj = this->dst_ptr_->find(key);
             if (recver_obj == nullptr) {
-                DstObjT obj(key);  // Construct obj using key only
+                if (this->drop_unknown_keys_)
+                    continue;
+                DstObjT obj(static_cast<typename DstObjT::KeyT>(key));  // Construct obj using key only
                 size_t idx = this->dst_ptr_->add_object(std::move(obj));
                 recver_obj = &(this->dst_ptr_->get(idx));
             }
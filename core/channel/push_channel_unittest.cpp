@@ -1,5 +1,6 @@
 #include "core/channel/push_channel.hpp"
 
+#include <memory>
 #include <string>
 #include <thread>
 #include <vector>
@@ -12,6 +13,7 @@
 #include "core/hash_ring.hpp"
 #include "core/mailbox.hpp"
 #include "core/objlist.hpp"
+#include "core/partitioner.hpp"
 #include "core/worker_info.hpp"
 
 namespace husky {
@@ -211,6 +213,64 @@ TEST_F(TestPushChannel, IncProgress) {
     EXPECT_EQ(msgs[0], 456);
 }
 
+TEST_F(TestPushChannel, KeyFilter) {
+    // On a thread of its own, which numbers its channels from 0
+    std::thread([&]() {
+        // Mailbox Setup
+        zmq::context_t zmq_context;
+        MailboxEventLoop el(&zmq_context);
+        el.set_process_id(0);
+        CentralRecver recver(&zmq_context, "inproc://test");
+        LocalMailbox mailbox(&zmq_context);
+        mailbox.set_thread_id(0);
+        el.register_mailbox(mailbox);
+
+        // WorkerInfo Setup
+        WorkerInfo workerinfo;
+        workerinfo.add_worker(0, 0, 0);
+        workerinfo.set_process_id(0);
+
+        // ObjList Setup
+        ObjList<Obj> src_list;
+        ObjList<Obj> dst_list;
+        for (int i = 0; i < 10; ++i)
+            dst_list.add_object(Obj(i));
+
+        // PushChannel
+        auto push_channel = create_push_channel<int>(src_list, dst_list);
+        push_channel.setup(0, 0, workerinfo, &mailbox);
+        push_channel.build_key_filter();
+        for (int i = 0; i < 1000; ++i)
+            push_channel.push(i, i);
+        push_channel.flush();
+        push_channel.prepare_messages();
+
+        // Messages to unknown keys are dropped by the receiver
+        EXPECT_EQ(dst_list.get_size(), 10);
+        for (auto& obj : dst_list.get_data()) {
+            auto& msgs = push_channel.get(obj);
+            EXPECT_EQ(msgs.size(), 1);
+            EXPECT_EQ(msgs[0], obj.id());
+        }
+
+        // Only the false positives of the filter are sent to unknown keys
+        push_channel.set_drop_unknown_keys(false);
+        for (int i = 0; i < 1000; ++i)
+            push_channel.push(i, i);
+        push_channel.flush();
+        push_channel.prepare_messages();
+        EXPECT_LT(dst_list.get_size(), 60);
+
+        // Without the filter, all messages are sent
+        size_t num_objs = dst_list.get_size();
+        push_channel.clear_key_filter();
+        push_channel.push(1, 5000);
+        push_channel.flush();
+        push_channel.prepare_messages();
+        EXPECT_EQ(dst_list.get_size(), num_objs + 1);
+    }).join();
+}
+
 TEST_F(TestPushChannel, MultiThread) {
     // Mailbox Setup
     zmq::context_t zmq_context;
@@ -315,5 +375,52 @@ TEST_F(TestPushChannel, MultiThread) {
     th2.join();
 }
 
+TEST_F(TestPushChannel, Partitioner) {
+    // Mailbox Setup
+    zmq::context_t zmq_context;
+    MailboxEventLoop el(&zmq_context);
+    el.set_process_id(0);
+    CentralRecver recver(&zmq_context, "inproc://test");
+    std::vector<std::unique_ptr<LocalMailbox>> mailboxes;
+    for (int i = 0; i < 2; ++i) {
+        mailboxes.emplace_back(new LocalMailbox(&zmq_context));
+        mailboxes[i]->set_thread_id(i);
+        el.register_mailbox(*mailboxes[i]);
+    }
+
+    // WorkerInfo Setup
+    WorkerInfo workerinfo;
+    workerinfo.add_worker(0, 0, 0);
+    workerinfo.add_worker(0, 1, 1);
+    workerinfo.set_process_id(0);
+
+    // Keys below 50 are loaded by worker 1, and the others by worker 0
+    auto partitioner = std::make_shared<RangePartitioner<int>>(std::vector<int>{50}, std::vector<int>{1, 0});
+    auto run = [&](int tid, std::vector<int> keys) {
+        ObjList<Obj> list;
+        list.set_partitioner(partitioner);
+        for (int key : keys)
+            list.add_object(Obj(key));
+        list.sort();
+
+        // No globalize is needed
+        auto push_channel = create_push_channel<int>(list, list);
+        push_channel.setup(tid, tid, workerinfo, mailboxes[tid].get());
+        for (int key : {1, 5, 18, 57, 100, 1342148})
+            push_channel.push(123, key);
+        push_channel.flush();
+        push_channel.prepare_messages();
+
+        EXPECT_EQ(list.get_size(), keys.size());
+        for (auto& obj : list.get_data())
+            EXPECT_EQ(push_channel.get(obj).size(), 2);
+    };
+    std::thread th1(run, 0, std::vector<int>{57, 100, 1342148});
+    std::thread th2(run, 1, std::vector<int>{1, 5, 18});
+
+    th1.join();
+    th2.join();
+}
+
 }  // namespace
 }  // namespace husky
@@ -16,10 +16,14 @@
 
 #include <time.h>
 
+#include <algorithm>
 #include <functional>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "base/assert.hpp"
 #include "base/serialization.hpp"
 #include "core/channel/channel_base.hpp"
 #include "core/channel/channel_impl.hpp"
@@ -34,6 +38,30 @@ namespace husky {
 
 using base::BinStream;
 
+namespace detail {
+
+// The number of processes per mirror group by default, which is the square root of the number of processes other
+// than the master's, so that the mirrors and the master receive about as many messages of a key
+inline int vertex_cut_group_size(int num_ranks) {
+    int group_size = 1;
+    while (group_size * group_size < num_ranks - 1)
+        group_size += 1;
+    return group_size;
+}
+
+// The rank of the process holding the mirror of a key for the process of `rank`, or -1 for the master's process.
+// The other processes are split into groups of `group_size` in the order of their ranks starting from the master's,
+// and the first process of each group holds the mirror. Keys with masters on different processes thus have their
+// mirrors on different processes.
+inline int vertex_cut_mirror_rank(int rank, int master_rank, int num_ranks, int group_size) {
+    int relative_rank = (rank - master_rank + num_ranks) % num_ranks;
+    if (relative_rank == 0)
+        return -1;
+    return (master_rank + 1 + (relative_rank - 1) / group_size * group_size) % num_ranks;
+}
+
+}  // namespace detail
+
 template <typename MsgT, typename DstObjT, typename CombineT>
 class PushCombinedChannel : public Source2ObjListChannel<DstObjT> {
    public:
@@ -68,12 +96,73 @@ class PushCombinedChannel : public Source2ObjListChannel<DstObjT> {
     }
 
     void push(const MsgT& msg, const typename DstObjT::KeyT& key) {
+        if (!mirrors_.empty()) {
+            auto iter = mirrors_.find(key);
+            if (iter != mirrors_.end()) {
+                auto& mirror = mirror_msgs_[iter->second];
+                if (mirror_flag_[iter->second])
+                    CombineT::combine(mirror.second, msg);
+                else
+                    mirror.second = msg;
+                mirror_flag_[iter->second] = true;
+                return;
+            }
+        }
         // shuffle_combiner_.init();  // Already move init() to create_shuffle_combiner_()
-        int dst_worker_id = this->worker_info_->get_hash_ring().hash_lookup(key);
+        int dst_worker_id = this->dst_ptr_->lookup_partition(key, this->worker_info_->get_hash_ring());
+        if (!this->may_exist(key, dst_worker_id))
+            return;
         auto& buffer = (*shuffle_combiner_)[this->local_id_].storage(dst_worker_id);
         back_combine<CombineT>(buffer, key, msg);
     }
 
+    /// \brief Keep a mirror of a high-degree object on this worker
+    ///
+    /// Messages pushed to a mirrored key are combined in place into the mirror instead of being buffered for
+    /// sort-combine. On its own, this only saves the local sorting of such messages: on flush, the mirrors are
+    /// merged with the shuffle combiner, so the master still receives one message of the key per process.
+    /// set_vertex_cut() sends the mirrors to mirror workers on other processes instead, which cuts the messages
+    /// to the master. Each worker decides its own mirrors, e.g., by add_mirrors().
+    void add_mirror(const typename DstObjT::KeyT& key) {
+        static_assert(!std::is_same<CombineT, IdenCombiner>::value, "IdenCombiner cannot combine into a mirror");
+        if (mirrors_.find(key) != mirrors_.end())
+            return;
+        mirrors_.emplace(key, mirror_msgs_.size());
+        mirror_msgs_.emplace_back(key, MsgT());
+        mirror_flag_.push_back(false);
+    }
+
+    /// Mirror the keys to which this worker pushes at least `threshold` messages per flush, as counted by
+    /// `num_msgs`, e.g., the local in-degrees of the destinations of the out-edges of the local vertices
+    void add_mirrors(const std::unordered_map<typename DstObjT::KeyT, size_t>& num_msgs, size_t threshold) {
+        for (auto& key_num : num_msgs) {
+            if (key_num.second >= threshold)
+                add_mirror(key_num.first);
+        }
+    }
+
+    /// \brief Combine the mirrors of the processes at mirror workers before they reach the master
+    ///
+    /// Like the mirrors of a vertex cut, the processes other than the master's process of a key are split into
+    /// groups of `group_size` processes, and each process sends its mirror of the key to a worker of the first
+    /// process in its group. That worker combines them and sends one message to the master, which then receives
+    /// one message of the key per group instead of one per process. The groups start from the master's process,
+    /// so the mirrors of keys with different masters are spread over the processes. 0 picks the square root of
+    /// the number of processes. It costs an extra mailbox round in flush(), so all workers must set it alike.
+    void set_vertex_cut(int group_size = 0) {
+        ASSERT_MSG(group_size >= 0, "The size of mirror groups should not be negative");
+        vertex_cut_ = true;
+        mirror_group_size_ = group_size;
+    }
+
+    /// Remove all the mirrors. Messages in the mirrors are sent on the next flush
+    void clear_mirrors() {
+        sync_mirrors();
+        mirrors_.clear();
+        mirror_msgs_.clear();
+        mirror_flag_.clear();
+    }
+
     const MsgT& get(const DstObjT& obj) {
         auto idx = this->dst_ptr_->index_of(&obj);
         if (idx >= recv_buffer_.size()) {  // resize recv_buffer_ and recv_flag_ if it is not large enough
@@ -107,8 +196,11 @@ class PushCombinedChannel : public Source2ObjListChannel<DstObjT> {
             int dst = (start + i) % send_buffer_.size();
             if (send_buffer_[dst].size() == 0)
                 continue;
+            size_t bytes = send_buffer_[dst].size();
             this->mailbox_->send(dst, this->channel_id_, this->progress_ + 1, send_buffer_[dst]);
             send_buffer_[dst].purge();
+            // Expect as many bytes to the destination in the next round
+            send_buffer_[dst].reserve(bytes);
         }
     }
 
@@ -120,6 +212,8 @@ class PushCombinedChannel : public Source2ObjListChannel<DstObjT> {
 
     /// This method is only useful without list_execute
     void flush() {
+        if (vertex_cut_)
+            send_mirrors();
         shuffle_combine();
         send();
         send_complete();
@@ -133,6 +227,7 @@ class PushCombinedChannel : public Source2ObjListChannel<DstObjT> {
         while (this->mailbox_->poll(this->channel_id_, this->progress_)) {
             auto bin_push = this->mailbox_->recv(this->channel_id_, this->progress_);
             process_bin(bin_push);
+            bin_push.recycle();
         }
         this->reset_flushed();
     }
@@ -144,11 +239,17 @@ class PushCombinedChannel : public Source2ObjListChannel<DstObjT> {
     std::vector<BinStream>& get_send_buffer() { return send_buffer_; }
 
    protected:
+    void set_compact_buffers(bool compact) override {
+        for (auto& buffer : send_buffer_)
+            buffer.set_compact(compact);
+    }
+
     void clear_recv_buffer_() { std::fill(recv_flag_.begin(), recv_flag_.end(), false); }
 
     void process_bin(BinStream& bin_push) {
         while (bin_push.size() != 0) {
-            typename DstObjT::KeyT key;
+            // Look up the key without materializing it, e.g., as a base::StringRef for string keys
+            typename base::ref_type<typename DstObjT::KeyT>::type key;
             bin_push >> key;
             MsgT msg;
             bin_push >> msg;
@@ -156,7 +257,9 @@ class PushCombinedChannel : public Source2ObjListChannel<DstObjT> {
             DstObjT* recver_obj = this->dst_ptr_->find(key);
             size_t idx;
             if (recver_obj == nullptr) {
-                DstObjT obj(key);  // Construct obj using key only
+                if (this->drop_unknown_keys_)
+                    continue;
+                DstObjT obj(static_cast<typename DstObjT::KeyT>(key));  // Construct obj using key only
                 idx = this->dst_ptr_->add_object(std::move(obj));
             } else {
                 idx = this->dst_ptr_->index_of(recver_obj);
@@ -174,7 +277,74 @@ class PushCombinedChannel : public Source2ObjListChannel<DstObjT> {
         }
     }
 
+    // Move the combined messages in the mirrors to the shuffle combiner
+    void sync_mirrors() {
+        auto& self_shuffle_combiner = (*shuffle_combiner_)[this->local_id_];
+        for (size_t i = 0; i < mirror_msgs_.size(); ++i) {
+            if (!mirror_flag_[i])
+                continue;
+            auto& mirror = mirror_msgs_[i];
+            int dst_worker_id = this->dst_ptr_->lookup_partition(mirror.first, this->worker_info_->get_hash_ring());
+            back_combine<CombineT>(self_shuffle_combiner.storage(dst_worker_id), mirror.first, mirror.second);
+            mirror_flag_[i] = false;
+        }
+    }
+
+    // Send the mirrors to their mirror workers in a round of their own, and merge the mirrors received by this
+    // worker with the shuffle combiner, which combines them into one message to the master
+    void send_mirrors() {
+        auto& self_shuffle_combiner = (*shuffle_combiner_)[this->local_id_];
+        for (size_t i = 0; i < mirror_msgs_.size(); ++i) {
+            if (!mirror_flag_[i])
+                continue;
+            auto& mirror = mirror_msgs_[i];
+            int dst_worker_id = this->dst_ptr_->lookup_partition(mirror.first, this->worker_info_->get_hash_ring());
+            int mirror_worker_id = lookup_mirror(mirror.first, dst_worker_id);
+            if (mirror_worker_id == -1)
+                back_combine<CombineT>(self_shuffle_combiner.storage(dst_worker_id), mirror.first, mirror.second);
+            else
+                send_buffer_[mirror_worker_id] << mirror.first << mirror.second;
+            mirror_flag_[i] = false;
+        }
+        send();
+        send_complete();
+        while (this->mailbox_->poll(this->channel_id_, this->progress_)) {
+            auto bin = this->mailbox_->recv(this->channel_id_, this->progress_);
+            while (bin.size() != 0) {
+                typename DstObjT::KeyT key;
+                MsgT msg;
+                bin >> key >> msg;
+                int dst_worker_id = this->dst_ptr_->lookup_partition(key, this->worker_info_->get_hash_ring());
+                back_combine<CombineT>(self_shuffle_combiner.storage(dst_worker_id), key, msg);
+            }
+            bin.recycle();
+        }
+    }
+
+    // The global id of the worker holding the mirror of key for this process, or -1 if this process holds the
+    // master, which is at worker `dst_worker_id`
+    int lookup_mirror(const typename DstObjT::KeyT& key, int dst_worker_id) {
+        if (mirror_pids_.empty()) {
+            mirror_pids_ = this->worker_info_->get_pids();
+            std::sort(mirror_pids_.begin(), mirror_pids_.end());
+            for (int i = 0; i < mirror_pids_.size(); ++i)
+                mirror_ranks_[mirror_pids_[i]] = i;
+            if (mirror_group_size_ == 0)
+                mirror_group_size_ = detail::vertex_cut_group_size(mirror_pids_.size());
+        }
+        int rank = mirror_ranks_.at(this->worker_info_->get_process_id());
+        int master_rank = mirror_ranks_.at(this->worker_info_->get_process_id(dst_worker_id));
+        int mirror_rank = detail::vertex_cut_mirror_rank(rank, master_rank, mirror_pids_.size(), mirror_group_size_);
+        if (mirror_rank == -1)
+            return -1;
+        int pid = mirror_pids_[mirror_rank];
+        return this->worker_info_->local_to_global_id(
+            pid, std::hash<typename DstObjT::KeyT>()(key) % this->worker_info_->get_num_local_workers(pid));
+    }
+
     void shuffle_combine() {
+        // step 0: sync mirrors
+        sync_mirrors();
         // step 1: shuffle combine
         auto& self_shuffle_combiner = (*shuffle_combiner_)[this->local_id_];
         self_shuffle_combiner.send_shuffler_buffer();
@@ -199,10 +369,8 @@ class PushCombinedChannel : public Source2ObjListChannel<DstObjT> {
         for (int i = this->local_id_; i < this->worker_info_->get_largest_tid() + 1;
              i += this->worker_info_->get_num_local_workers()) {
             auto& combine_buffer = self_shuffle_combiner.storage(i);
-            for (int k = 0; k < combine_buffer.size(); k++) {
-                send_buffer_[i] << combine_buffer[k].first;
-                send_buffer_[i] << combine_buffer[k].second;
-            }
+            // key-message pairs of trivially serializable types are copied as one block
+            base::serialize_range(send_buffer_[i], combine_buffer.data(), combine_buffer.size());
             combine_buffer.clear();
         }
     }
@@ -211,6 +379,15 @@ class PushCombinedChannel : public Source2ObjListChannel<DstObjT> {
     std::vector<BinStream> send_buffer_;
     std::vector<MsgT> recv_buffer_;
     std::vector<bool> recv_flag_;
+    // Mirrors of high-degree objects, indexed by key
+    std::unordered_map<typename DstObjT::KeyT, size_t> mirrors_;
+    std::vector<std::pair<typename DstObjT::KeyT, MsgT>> mirror_msgs_;
+    std::vector<bool> mirror_flag_;
+    // See set_vertex_cut. The processes are ranked by their ids
+    bool vertex_cut_ = false;
+    int mirror_group_size_ = 0;
+    std::vector<int> mirror_pids_;
+    std::unordered_map<int, int> mirror_ranks_;
 };
 
 }  // namespace husky
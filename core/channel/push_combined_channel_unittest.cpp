@@ -1,6 +1,9 @@
 #include "core/channel/push_combined_channel.hpp"
 
+#include <atomic>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -194,6 +197,52 @@ TEST_F(TestPushCombinedChannel, IncProgress) {
     EXPECT_EQ(msgs, 456);
 }
 
+TEST_F(TestPushCombinedChannel, Mirror) {
+    // On a thread of its own, which numbers its channels from 0
+    std::thread([&]() {
+        // Mailbox Setup
+        zmq::context_t zmq_context;
+        MailboxEventLoop el(&zmq_context);
+        el.set_process_id(0);
+        CentralRecver recver(&zmq_context, "inproc://test");
+        LocalMailbox mailbox(&zmq_context);
+        mailbox.set_thread_id(0);
+        el.register_mailbox(mailbox);
+
+        // WorkerInfo Setup
+        WorkerInfo workerinfo;
+        workerinfo.add_worker(0, 0, 0);
+        workerinfo.set_process_id(0);
+
+        // ObjList Setup
+        ObjList<Obj> src_list;
+        ObjList<Obj> dst_list;
+
+        // PushChannel
+        auto push_channel = create_push_combined_channel<int, SumCombiner<int>>(src_list, dst_list);
+        push_channel.setup(0, 0, workerinfo, &mailbox);
+        push_channel.add_mirror(10);
+        // Round 1
+        push_channel.push(1, 11);
+        for (int i = 1; i <= 100; ++i)
+            push_channel.push(i, 10);
+        push_channel.push(2, 11);
+        push_channel.flush();
+        push_channel.prepare_messages();
+
+        EXPECT_EQ(push_channel.get(*dst_list.find(10)), 5050);
+        EXPECT_EQ(push_channel.get(*dst_list.find(11)), 3);
+
+        // Round 2
+        push_channel.push(3, 11);
+        push_channel.flush();
+        push_channel.prepare_messages();
+
+        EXPECT_FALSE(push_channel.has_msgs(*dst_list.find(10)));
+        EXPECT_EQ(push_channel.get(*dst_list.find(11)), 3);
+    }).join();
+}
+
 TEST_F(TestPushCombinedChannel, MultiThread) {
     // Mailbox Setup
     zmq::context_t zmq_context;
@@ -298,5 +347,85 @@ TEST_F(TestPushCombinedChannel, MultiThread) {
     th2.join();
 }
 
+TEST_F(TestPushCombinedChannel, VertexCutGroups) {
+    // The master of a hot key receives one message per mirror group instead of one per other process
+    const int kNumRanks = 10;
+    int group_size = detail::vertex_cut_group_size(kNumRanks);
+    EXPECT_EQ(group_size, 3);
+    std::vector<int> num_mirrors(kNumRanks, 0);
+    for (int master_rank = 0; master_rank < kNumRanks; ++master_rank) {
+        std::set<int> senders_to_master;
+        for (int rank = 0; rank < kNumRanks; ++rank) {
+            int mirror_rank = detail::vertex_cut_mirror_rank(rank, master_rank, kNumRanks, group_size);
+            if (rank == master_rank) {
+                EXPECT_EQ(mirror_rank, -1);
+                continue;
+            }
+            EXPECT_NE(mirror_rank, master_rank);
+            senders_to_master.insert(mirror_rank);
+        }
+        EXPECT_EQ(senders_to_master.size(), 3);
+        for (int mirror_rank : senders_to_master)
+            num_mirrors[mirror_rank] += 1;
+    }
+    // Keys with different masters have their mirrors on different processes
+    for (int rank = 0; rank < kNumRanks; ++rank)
+        EXPECT_EQ(num_mirrors[rank], 3);
+}
+
+TEST_F(TestPushCombinedChannel, VertexCut) {
+    // Mailbox Setup
+    zmq::context_t zmq_context;
+    MailboxEventLoop el(&zmq_context);
+    el.set_process_id(0);
+    CentralRecver recver(&zmq_context, "inproc://test");
+    LocalMailbox mailbox_0(&zmq_context);
+    mailbox_0.set_thread_id(0);
+    el.register_mailbox(mailbox_0);
+    LocalMailbox mailbox_1(&zmq_context);
+    mailbox_1.set_thread_id(1);
+    el.register_mailbox(mailbox_1);
+
+    // WorkerInfo Setup
+    WorkerInfo workerinfo;
+    workerinfo.add_worker(0, 0, 0);
+    workerinfo.add_worker(0, 1, 1);
+    workerinfo.set_process_id(0);
+
+    // Both workers mirror key 10, and the masters still get every message after the mirror round
+    std::vector<std::thread> threads;
+    std::vector<LocalMailbox*> mailboxes = {&mailbox_0, &mailbox_1};
+    std::atomic<int> num_masters(0);
+    for (int tid = 0; tid < 2; ++tid) {
+        threads.emplace_back([&, tid]() {
+            ObjList<Obj> src_list;
+            ObjList<Obj> dst_list;
+            auto push_channel = create_push_combined_channel<int, SumCombiner<int>>(src_list, dst_list);
+            push_channel.setup(tid, tid, workerinfo, mailboxes[tid]);
+            push_channel.set_vertex_cut();
+            push_channel.add_mirrors({{10, 100}, {11, 1}}, 100);
+            for (int round = 0; round < 2; ++round) {
+                for (int i = 1; i <= 100; ++i)
+                    push_channel.push(i, 10);
+                push_channel.push(1, 11);
+                push_channel.flush();
+                push_channel.prepare_messages();
+
+                if (dst_list.find(10) != nullptr) {
+                    EXPECT_EQ(push_channel.get(*dst_list.find(10)), 10100);
+                    num_masters += 1;
+                }
+                if (dst_list.find(11) != nullptr) {
+                    EXPECT_EQ(push_channel.get(*dst_list.find(11)), 2);
+                    num_masters += 1;
+                }
+            }
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+    EXPECT_EQ(num_masters, 4);
+}
+
 }  // namespace
 }  // namespace husky
@@ -25,6 +25,10 @@ const int MAX_NUM_LOCAL_WORKERS = 100;
 // async migration
 const int MIGRATE_BUFFER_THRESHOLD = 3500;
 
+// bounds of the auto-tuned batch size of async channels
+const size_t ASYNC_MIN_BATCH_BYTES = 4096;
+const size_t ASYNC_MAX_BATCH_BYTES = 4 << 20;
+
 //
 // below are magic numbers.
 //
@@ -49,6 +53,7 @@ const uint32_t MAILBOX_EVENT_RECV_COMM_REQ = (COMM_REQ << 2);
 const uint32_t MAILBOX_EVENT_SEND_COMM = 0x30eb1266;
 const uint32_t MAILBOX_EVENT_SEND_COMM_PRGS = 0x33eb1266;
 const uint32_t MAILBOX_EVENT_SEND_COMM_END = 0x303b1266;
+const uint32_t MAILBOX_EVENT_SEND_COMM_ACK = 0x30eb1366;
 const uint32_t MAILBOX_EVENT_DESTROY = 0x303b1276;
 
 /// coordinate with master
@@ -17,20 +17,35 @@
 #include <string>
 #include <vector>
 
+#include "base/assert.hpp"
+
 namespace husky {
 
 ContextGlobal Context::global_;
 thread_local ContextLocal Context::local_;
 
 void Context::create_mailbox_env() {
-    global_.mailbox_event_loop.reset(new MailboxEventLoop(&global_.zmq_context_));
+    // Each peer is connected to this many recvers of the process, and every connection may be served by an I/O
+    // thread of its own. zmq only takes the number of I/O threads when the context starts, so the context is
+    // recreated with it before the mailboxes create their sockets.
+    int num_connections = std::stoi(global_.config.get_param("mailbox_connections_per_peer", "1"));
+    ASSERT_MSG(num_connections > 0, "mailbox_connections_per_peer should be positive");
+    ASSERT_MSG(global_.mailbox_event_loop == nullptr, "The mailbox environment is already created");
+    global_.zmq_context_.reset(new zmq::context_t(num_connections));
+
+    // More shards let the event loop serve the channels in parallel
+    int num_event_loop_shards = std::stoi(global_.config.get_param("mailbox_event_loop_shards", "1"));
+    global_.mailbox_event_loop.reset(new MailboxEventLoop(get_zmq_context(), num_event_loop_shards));
     global_.mailbox_event_loop->set_process_id(get_process_id());
+    // Bytes in flight to each peer when the sends are scheduled as an all-to-all exchange, 0 to send at once
+    global_.mailbox_event_loop->set_exchange_window(
+        std::stoull(global_.config.get_param("mailbox_exchange_window", "0")));
 
     global_.local_mailboxes_.resize(get_num_local_workers());
     int local_tid = 0;
     for (int global_tid = 0; global_tid < get_num_global_workers(); global_tid++) {
         if (global_.worker_info.get_process_id(global_tid) == get_process_id()) {
-            global_.local_mailboxes_.at(local_tid).reset(new LocalMailbox(&global_.zmq_context_));
+            global_.local_mailboxes_.at(local_tid).reset(new LocalMailbox(get_zmq_context()));
             global_.local_mailboxes_.at(local_tid)->set_process_id(get_process_id());
             global_.local_mailboxes_.at(local_tid)->set_thread_id(global_tid);
             global_.mailbox_event_loop->register_mailbox(*(global_.local_mailboxes_.at(local_tid).get()));
@@ -41,12 +56,30 @@ void Context::create_mailbox_env() {
         }
     }
 
+    // Processes on the same host send to each other through shared memory, unless the ring size is set to 0
+    size_t shm_ring_size = std::stoull(global_.config.get_param("mailbox_shm_ring_size", "8388608"));
+    std::string shm_ring_prefix =
+        "/husky-" + global_.config.get_master_host() + "-" + std::to_string(global_.config.get_master_port());
+    const auto& hostname = global_.worker_info.get_hostname(get_process_id());
     for (int proc_id = 0; proc_id < get_num_processes(); proc_id++) {
-        global_.mailbox_event_loop->register_peer_recver(proc_id, "tcp://" + global_.worker_info.get_hostname(proc_id) +
-                                                                      ":" +
-                                                                      std::to_string(global_.config.get_comm_port()));
+        std::vector<std::string> addrs;
+        for (int i = 0; i < num_connections; ++i)
+            addrs.push_back("tcp://" + global_.worker_info.get_hostname(proc_id) + ":" +
+                            std::to_string(global_.config.get_comm_port() + i));
+        global_.mailbox_event_loop->register_peer_recver(proc_id, addrs);
+        if (shm_ring_size == 0 || proc_id == get_process_id() || global_.worker_info.get_hostname(proc_id) != hostname)
+            continue;
+        // One ring for each event loop shard of the peer, which all processes configure alike
+        for (int shard = 0; shard < num_event_loop_shards; ++shard)
+            global_.shm_recvers.emplace_back(
+                new ShmRecver(get_zmq_context(),
+                              shm_ring_name(shm_ring_prefix, proc_id, get_process_id(), shard), shm_ring_size,
+                              num_event_loop_shards));
+        global_.mailbox_event_loop->register_peer_shm(proc_id, shm_ring_prefix);
     }
-    global_.central_recver.reset(new CentralRecver(get_zmq_context(), get_recver_bind_addr()));
+    for (int i = 0; i < num_connections; ++i)
+        global_.central_recvers.emplace_back(
+            new CentralRecver(get_zmq_context(), get_recver_bind_addr(i), num_event_loop_shards));
 }
 
 }  // namespace husky
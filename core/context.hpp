@@ -29,14 +29,17 @@ struct ContextGlobal {
     ~ContextGlobal() {
         // Order is important
         local_mailboxes_.clear();
-        central_recver.reset(nullptr);
+        central_recvers.clear();
+        shm_recvers.clear();
         mailbox_event_loop.reset(nullptr);
     }
 
-    zmq::context_t zmq_context_;
+    // Replaced by create_mailbox_env with a context of the configured number of I/O threads
+    std::unique_ptr<zmq::context_t> zmq_context_{new zmq::context_t()};
     std::vector<std::unique_ptr<LocalMailbox>> local_mailboxes_;
     std::unique_ptr<MailboxEventLoop> mailbox_event_loop;
-    std::unique_ptr<CentralRecver> central_recver;
+    std::vector<std::unique_ptr<CentralRecver>> central_recvers;
+    std::vector<std::unique_ptr<ShmRecver>> shm_recvers;
     Config config;
     Coordinator coordinator;
     MemoryChecker memory_checker;
@@ -54,14 +57,18 @@ class Context {
 
     /// \brief Initialize the mailbox sub-system
     ///
-    /// This method can only be called after a Husky configuration is loaded.
+    /// This method can only be called after a Husky configuration is loaded, and before any socket is
+    /// created on the zmq context, which is recreated with the I/O threads of the configuration.
     /// This will initialize the local mailbox for each thread, as well as setting up the mailbox
     /// event-loop and the mailbox central receiver.
     static void create_mailbox_env();
 
     static LocalMailbox* get_mailbox(int local_tid) { return global_.local_mailboxes_.at(local_tid).get(); }
 
-    static std::string get_recver_bind_addr() { return "tcp://*:" + std::to_string(global_.config.get_comm_port()); }
+    /// The address of the `connection`-th recver of the process, which listens on comm_port + connection
+    static std::string get_recver_bind_addr(int connection = 0) {
+        return "tcp://*:" + std::to_string(global_.config.get_comm_port() + connection);
+    }
 
     static std::string get_param(const std::string& key) { return global_.config.get_param(key); }
 
@@ -95,7 +102,7 @@ class Context {
 
     static const void set_worker_info(WorkerInfo&& worker_info) { global_.worker_info = worker_info; }
 
-    static zmq::context_t* get_zmq_context() { return &global_.zmq_context_; }
+    static zmq::context_t* get_zmq_context() { return global_.zmq_context_.get(); }
 
     // The following are local methods
 
@@ -82,13 +82,15 @@ void balance(ObjList<ObjT>& obj_list) {
     balance(obj_list, base_balance_algo);
 }
 
+// Move each object to the worker owning its key by the partitioner of obj_list (see ObjList::set_partitioner).
+// A list loaded in agreement with its partitioner is already globalized.
 template <typename ObjT>
 void globalize(ObjList<ObjT>& obj_list) {
     // create a migrate channel for globalize
     auto& migrate_channel = ChannelStore::create_migrate_channel(obj_list, obj_list);
 
     for (auto& obj : obj_list.get_data()) {
-        int dst_thread_id = Context::get_hash_ring().hash_lookup(obj.id());
+        int dst_thread_id = obj_list.lookup_partition(obj.id(), Context::get_hash_ring());
         if (dst_thread_id != Context::get_global_tid())
             migrate_channel.migrate(obj, dst_thread_id);
     }
@@ -142,6 +144,8 @@ void list_execute_async(ObjList<ObjT>& obj_list, ExecT execute, int async_time,
         // 3. flush
         channel->out();
     }
+    // Messages held back by flow control must go before send_complete
+    channel->send();
     mailbox->send_complete(channel->get_channel_id(), channel->get_progress(),
                            Context::get_worker_info().get_local_tids(), Context::get_worker_info().get_pids());
     channel->prepare();
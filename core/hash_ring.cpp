@@ -41,8 +41,12 @@ int HashRing::lookup(uint64_t pos) const {
     return global_tids_vector_[b];
 }
 
-BinStream& operator<<(BinStream& stream, HashRing& hash_ring) { return stream << hash_ring.global_tids_vector_; }
+BinStream& operator<<(BinStream& stream, HashRing& hash_ring) {
+    return stream << hash_ring.global_tids_vector_ << hash_ring.consistent_;
+}
 
-BinStream& operator>>(BinStream& stream, HashRing& hash_ring) { return stream >> hash_ring.global_tids_vector_; }
+BinStream& operator>>(BinStream& stream, HashRing& hash_ring) {
+    return stream >> hash_ring.global_tids_vector_ >> hash_ring.consistent_;
+}
 
 }  // namespace husky
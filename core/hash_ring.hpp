@@ -17,6 +17,7 @@
 #include <set>
 #include <vector>
 
+#include "base/hash.hpp"
 #include "base/serialization.hpp"
 
 namespace husky {
@@ -31,17 +32,30 @@ class HashRing {
     /// Remove a worker thread from the hash ring.
     void remove(int tid);
 
-    /// Given a position on the hash ring, return the worker thread id.
+    /// Given a position on the hash ring, return the worker thread id using jump consistent hashing,
+    /// which moves only 1/n of the positions when the n-th range is inserted.
     int lookup(uint64_t pos) const;
 
+    /// Given a position on the hash ring, return the worker thread id in O(1) by scaling the high 32 bits
+    /// of pos to the number of ranges. The mapping is uniform but not stable when the worker set changes.
+    inline int fast_lookup(uint64_t pos) const {
+        return global_tids_vector_[((pos >> 32) * global_tids_vector_.size()) >> 32];
+    }
+
+    /// Map a key to a worker thread id. The key hash is mixed first since std::hash is the identity for
+    /// integers, and the mapping follows the consistent mode of the ring.
     template <typename KeyT>
     int hash_lookup(const KeyT& key) const {
-        // Maybe we just use std::hash<KeyT>() ??
-        // uint64_t pos = ObjT::partition(key);
-        uint64_t pos = std::hash<KeyT>()(key);
-        return lookup(pos);
+        uint64_t pos = base::mix64(std::hash<KeyT>()(key));
+        return consistent_ ? lookup(pos) : fast_lookup(pos);
     }
 
+    /// Use jump consistent hashing in hash_lookup, for worker sets that change while objects stay put.
+    /// By default the worker set is fixed for a job and the O(1) mapping is used.
+    inline void set_consistent(bool consistent) { consistent_ = consistent; }
+
+    inline bool is_consistent() const { return consistent_; }
+
     inline int get_global_tids_size() const { return global_tids_vector_.size(); }
 
     friend BinStream& operator<<(BinStream& stream, HashRing& hash_ring);
@@ -49,6 +63,7 @@ class HashRing {
 
    protected:
     std::vector<int> global_tids_vector_;
+    bool consistent_ = false;
 };
 
 BinStream& operator<<(BinStream& stream, HashRing& hash_ring);
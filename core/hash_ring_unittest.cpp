@@ -80,6 +80,57 @@ TEST_F(TestHashRing, FunctionalWithVirtualNodes) {
         EXPECT_EQ(hash_ring.lookup(i), locations[i]);
 }
 
+TEST_F(TestHashRing, FastLookup) {
+    HashRing hash_ring;
+    for (int i = 0; i < 4; i++)
+        hash_ring.insert(i * 10);
+
+    // Positions are scaled by their high bits
+    EXPECT_EQ(hash_ring.fast_lookup(0), 0);
+    EXPECT_EQ(hash_ring.fast_lookup(0x4000000000000000ULL), 10);
+    EXPECT_EQ(hash_ring.fast_lookup(0x8000000000000000ULL), 20);
+    EXPECT_EQ(hash_ring.fast_lookup(0xffffffffffffffffULL), 30);
+}
+
+TEST_F(TestHashRing, HashLookupBalance) {
+    HashRing hash_ring;
+    const int num_workers = 8;
+    for (int i = 0; i < num_workers; i++)
+        hash_ring.insert(i);
+
+    // Strided ids would all land on one worker if the identity hash were scaled directly
+    for (bool consistent : {false, true}) {
+        hash_ring.set_consistent(consistent);
+        std::vector<int> counts(num_workers, 0);
+        const int num_keys = 80000;
+        for (int i = 0; i < num_keys; i++)
+            counts[hash_ring.hash_lookup(i * num_workers)] += 1;
+        for (int count : counts) {
+            EXPECT_GT(count, num_keys / num_workers * 9 / 10);
+            EXPECT_LT(count, num_keys / num_workers * 11 / 10);
+        }
+    }
+}
+
+TEST_F(TestHashRing, ConsistentLookup) {
+    HashRing hash_ring;
+    hash_ring.set_consistent(true);
+    EXPECT_TRUE(hash_ring.is_consistent());
+    for (int i = 0; i < 5; i++)
+        hash_ring.insert(i);
+
+    std::vector<int> before;
+    for (int i = 0; i < 1000; i++)
+        before.push_back(hash_ring.hash_lookup(i));
+
+    // Adding a worker only moves keys to the new worker
+    hash_ring.insert(5);
+    for (int i = 0; i < 1000; i++) {
+        int tid = hash_ring.hash_lookup(i);
+        EXPECT_TRUE(tid == before[i] || tid == 5);
+    }
+}
+
 TEST_F(TestHashRing, Serialization) {
     HashRing input, output;
     BinStream stream;
@@ -94,6 +145,14 @@ TEST_F(TestHashRing, Serialization) {
     stream << input;
     stream >> output;
     EXPECT_EQ(input.get_global_tids_size(), output.get_global_tids_size());
+    EXPECT_FALSE(output.is_consistent());
+
+    input.set_consistent(true);
+    stream << input;
+    stream >> output;
+    EXPECT_TRUE(output.is_consistent());
+    for (int i = 0; i < 20; i++)
+        EXPECT_EQ(input.hash_lookup(i), output.hash_lookup(i));
 }
 
 }  // namespace
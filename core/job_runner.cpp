@@ -43,6 +43,7 @@ bool init_with_args(int ac, char** av, const std::vector<std::string>& customize
     if (succ) {
         if (!config.get_log_dir().empty())
             base::log_to_dir(config.get_log_dir());
+        worker_info.set_consistent_hashing(config.get_param("hash_ring_consistent", "0") == "1");
         Context::set_config(std::move(config));
         Context::set_worker_info(std::move(worker_info));
     }
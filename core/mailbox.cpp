@@ -14,6 +14,10 @@
 
 #include "core/mailbox.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -28,11 +32,12 @@ namespace husky {
 
 const char* kEventLoopListenAddress = "inproc://central-event-loop";
 
-LocalMailbox::LocalMailbox(zmq::context_t* zmq_context) : zmq_context_(zmq_context) {
-    event_loop_connector_ = new EventLoopConnector(zmq_context_);
-    comm_completed_.init(false);
+std::string event_loop_listen_address(int shard_id) {
+    return kEventLoopListenAddress + std::string("-") + std::to_string(shard_id);
 }
 
+LocalMailbox::LocalMailbox(zmq::context_t* zmq_context) : zmq_context_(zmq_context) { comm_completed_.init(false); }
+
 LocalMailbox::~LocalMailbox() { delete event_loop_connector_; }
 
 void LocalMailbox::set_thread_id(int thread_id) { thread_id_ = thread_id; }
@@ -46,10 +51,7 @@ bool LocalMailbox::poll(int channel_id, int progress) {
 
     // step 2: check the flag
     // block when the queue is not empty but the flag is true
-    // std::unique_lock<std::mutex> lock(poll_mutex_.get(channel_id, progress));
-    std::unique_lock<std::mutex> lock(notify_lock_);
-
-    poll_cv_.wait(lock, [&]() {
+    wait_for_channel(channel_id, [&]() {
         if (in_queue_.get(channel_id, progress).size() > 0)
             return true;
         if (comm_completed_.get(channel_id, progress))
@@ -66,10 +68,10 @@ bool LocalMailbox::poll(int channel_id, int progress) {
     // The following is to re-use cells in comm_completed_.
     // It's based on the assumption that Channel progress
     // won't decrease
+    std::lock_guard<std::mutex> lock(notify_lock_);
     int prgs_to_reset = progress - 1;
     while (prgs_to_reset >= 0 && comm_completed_.get(channel_id, prgs_to_reset)) {
-        comm_completed_.get(channel_id, prgs_to_reset) = false;
-        in_queue_.get(channel_id, prgs_to_reset).clear();
+        reset_progress(channel_id, prgs_to_reset);
         prgs_to_reset -= 1;
     }
 
@@ -90,16 +92,16 @@ bool LocalMailbox::poll_with_timeout(int channel_id, int progress, double timeou
 
     // step 2: check the flag
     // block when the queue is not empty but the flag is true
-    std::unique_lock<std::mutex> lock(poll_mutex_.get(channel_id, progress));
-
-    poll_cv_.wait_for(lock, std::chrono::duration<double>(timeout), [&]() {
-        if (in_queue_.get(channel_id, progress).size() > 0)
-            return true;
-        if (comm_completed_.get(channel_id, progress))
-            return true;
+    wait_for_channel(channel_id,
+                     [&]() {
+                         if (in_queue_.get(channel_id, progress).size() > 0)
+                             return true;
+                         if (comm_completed_.get(channel_id, progress))
+                             return true;
 
-        return false;
-    });
+                         return false;
+                     },
+                     timeout);
 
     if (in_queue_.get(channel_id, progress).size() > 0)
         return true;
@@ -114,8 +116,7 @@ bool LocalMailbox::poll(const std::vector<std::pair<int, int>>& channel_progress
         }
     }
 
-    std::unique_lock<std::mutex> lock(notify_lock_);
-    poll_cv_.wait(lock, [&]() {
+    wait_for_channel(kWaitingAnyChannel, [&]() {
         for (auto& chnl_prgs_pair : channel_progress_pairs)
             if (in_queue_.get(chnl_prgs_pair.first, chnl_prgs_pair.second).size() > 0)
                 return true;
@@ -137,11 +138,11 @@ bool LocalMailbox::poll(const std::vector<std::pair<int, int>>& channel_progress
         }
     }
 
+    std::lock_guard<std::mutex> lock(notify_lock_);
     for (auto& chnl_prgs_pair : channel_progress_pairs) {
         int prgs_to_reset = chnl_prgs_pair.second - 1;
         while (prgs_to_reset >= 0 && comm_completed_.get(chnl_prgs_pair.first, prgs_to_reset)) {
-            comm_completed_.get(chnl_prgs_pair.first, prgs_to_reset) = false;
-            in_queue_.get(chnl_prgs_pair.first, prgs_to_reset).clear();
+            reset_progress(chnl_prgs_pair.first, prgs_to_reset);
             prgs_to_reset -= 1;
         }
     }
@@ -149,32 +150,104 @@ bool LocalMailbox::poll(const std::vector<std::pair<int, int>>& channel_progress
     return false;
 }
 
+void LocalMailbox::reset_progress(int channel_id, int progress) {
+    comm_completed_.get(channel_id, progress) = false;
+    auto& queue = in_queue_.get(channel_id, progress);
+    while (queue.size() > 0) {
+        BinStream* bin_stream_ptr = queue.pop();
+        queued_bytes_ -= bin_stream_ptr->size();
+        delete bin_stream_ptr;
+    }
+}
+
+void LocalMailbox::wait_for_channel(int channel_id, const std::function<bool()>& pred) {
+    std::unique_lock<std::mutex> lock(notify_lock_);
+    // Publish the channel before checking the queues, so a sender either pushes before the check or sees the waiter
+    waiting_channel_ = channel_id;
+    poll_cv_.wait(lock, pred);
+    waiting_channel_ = kNotWaiting;
+}
+
+bool LocalMailbox::wait_for_channel(int channel_id, const std::function<bool()>& pred, double timeout) {
+    std::unique_lock<std::mutex> lock(notify_lock_);
+    waiting_channel_ = channel_id;
+    bool ret = poll_cv_.wait_for(lock, std::chrono::duration<double>(timeout), pred);
+    waiting_channel_ = kNotWaiting;
+    return ret;
+}
+
+void LocalMailbox::notify_channel(int channel_id) {
+    int waiting_channel = waiting_channel_;
+    if (waiting_channel == channel_id || waiting_channel == kWaitingAnyChannel) {
+        std::lock_guard<std::mutex> lock(notify_lock_);
+        poll_cv_.notify_one();
+    }
+}
+
 BinStream LocalMailbox::recv(int channel_id, int progress) {
     ASSERT_MSG(in_queue_.get(channel_id, progress).size() > 0, "Please poll before recv");
 
     BinStream* recv_bin_stream_ptr = in_queue_.get(channel_id, progress).pop();
     BinStream recv_bin_stream(std::move(*recv_bin_stream_ptr));
+    delete recv_bin_stream_ptr;
+    queued_bytes_ -= recv_bin_stream.size();
+    if (recv_bin_stream.is_compressed())
+        base::decompress(&recv_bin_stream);
+    if (compact_channels_.count(channel_id) != 0)
+        recv_bin_stream.set_compact(true);
     return recv_bin_stream;
 }
 
+int LocalMailbox::get_queue_depth(int channel_id, int progress) { return in_queue_.get(channel_id, progress).size(); }
+
 void LocalMailbox::send(int thread_id, int channel_id, int progress, BinStream& bin_stream) {
+    bool to_local = event_loop_ != nullptr && event_loop_->registered_mailbox_.count(thread_id) != 0;
+    auto compression = compression_.find(channel_id);
+    if (compression != compression_.end()) {
+        // Only the network is worth compressing for, so streams within the host only get the trailer
+        bool to_host = to_local || (event_loop_ != nullptr && event_loop_->tid_to_pid_.count(thread_id) != 0 &&
+                                    event_loop_->shm_ring_prefix_.count(event_loop_->tid_to_pid_.at(thread_id)) != 0);
+        bool worth = !to_host && bin_stream.size() >= compression->second.second;
+        base::compress(&bin_stream, worth ? compression->second.first : base::CompressionCodec::None);
+    }
+    if (to_local) {
+        event_loop_->_recv_comm_handler(thread_id, channel_id, progress, new BinStream(std::move(bin_stream)));
+        return;
+    }
+    ASSERT_MSG(event_loop_connector_ != nullptr, "Need to register the mailbox to the event loop before sending");
     event_loop_connector_->generate_out_comm_event(thread_id, channel_id, progress, bin_stream);
 }
 
+void LocalMailbox::set_compact_serialization(int channel_id, bool compact) {
+    if (compact)
+        compact_channels_.insert(channel_id);
+    else
+        compact_channels_.erase(channel_id);
+}
+
+void LocalMailbox::set_compression(int channel_id, base::CompressionCodec codec, size_t min_bytes) {
+    ASSERT_MSG(base::is_compression_available(codec), "The compression codec is not built into Husky");
+    if (codec == base::CompressionCodec::None)
+        compression_.erase(channel_id);
+    else
+        compression_[channel_id] = std::make_pair(codec, min_bytes);
+}
+
 void LocalMailbox::send_complete(int channel_id, int progress, const std::vector<int>& sender_tids,
                                  const std::vector<int>& recver_pids) {
     if (std::find(sender_tids.begin(), sender_tids.end(), thread_id_) != sender_tids.end()) {
+        ASSERT_MSG(event_loop_connector_ != nullptr, "Need to register the mailbox to the event loop before sending");
         auto* recver_pids_copy = new std::vector<int>(recver_pids);
         event_loop_connector_->generate_out_comm_complete_event(channel_id, progress, sender_tids.size(),
                                                                 recver_pids_copy);
     }
 }
 
-CentralRecver::CentralRecver(zmq::context_t* zmq_context, const std::string& bind_addr)
+CentralRecver::CentralRecver(zmq::context_t* zmq_context, const std::string& bind_addr, int num_event_loop_shards)
     : zmq_context_(zmq_context), comm_recver_(*zmq_context_, ZMQ_PULL) {
     bind_addr_ = bind_addr;
     comm_recver_.bind(bind_addr_);
-    event_loop_connector_ = new EventLoopConnector(zmq_context_);
+    event_loop_connector_ = new EventLoopConnector(zmq_context_, num_event_loop_shards);
     recver_thread_ = new std::thread([&]() { serve(); });
 }
 
@@ -204,49 +277,123 @@ void CentralRecver::serve() {
             int channel_id = zmq_recv_int32(&comm_recver_);
             int progress = zmq_recv_int32(&comm_recver_);
             int num_global_sync_processes = zmq_recv_int32(&comm_recver_);
-            event_loop_connector_->generate_in_comm_complete_event(channel_id, progress, num_global_sync_processes);
+            int process_id = zmq_recv_int32(&comm_recver_);
+            int num_connections = zmq_recv_int32(&comm_recver_);
+            event_loop_connector_->generate_in_comm_complete_event(channel_id, progress, num_global_sync_processes,
+                                                                   process_id, num_connections);
+            continue;
+        }
+
+        if (thread_id == -3) {
+            int channel_id = zmq_recv_int32(&comm_recver_);
+            int process_id = zmq_recv_int32(&comm_recver_);
+            int64_t acked_bytes = zmq_recv_int64(&comm_recver_);
+            event_loop_connector_->generate_out_comm_ack_event(channel_id, process_id, acked_bytes);
             continue;
         }
 
         int channel_id = zmq_recv_int32(&comm_recver_);
         int progress = zmq_recv_int32(&comm_recver_);
-        BinStream* bin_stream_ptr = new BinStream();
-        *bin_stream_ptr = zmq_recv_binstream(&comm_recver_);
-        event_loop_connector_->generate_in_comm_event(thread_id, channel_id, progress, bin_stream_ptr);
+        int ack_process_id = zmq_recv_int32(&comm_recver_);
+        int compressed = zmq_recv_int32(&comm_recver_);
+        BinStream* bin_stream_ptr = new BinStream(zmq_recv_binstream(&comm_recver_));
+        bin_stream_ptr->set_compressed(compressed != 0);
+        event_loop_connector_->generate_in_comm_event(thread_id, channel_id, progress, bin_stream_ptr, ack_process_id);
     }
 }
 
-MailboxEventLoop::MailboxEventLoop(zmq::context_t* zmq_context)
-    : zmq_context_(zmq_context), event_recver_(*zmq_context_, ZMQ_PULL) {
-    event_recver_.bind(kEventLoopListenAddress);
+std::string shm_ring_name(const std::string& prefix, int src_pid, int dst_pid, int shard) {
+    return prefix + "-" + std::to_string(src_pid) + "-" + std::to_string(dst_pid) + "-" + std::to_string(shard);
+}
 
-    // register event handlers
-    register_event_handler(MAILBOX_EVENT_SEND_COMM, std::bind(&MailboxEventLoop::send_comm_handler, this));
-    register_event_handler(MAILBOX_EVENT_SEND_COMM_END, std::bind(&MailboxEventLoop::send_comm_complete_handler, this));
-    register_event_handler(MAILBOX_EVENT_RECV_COMM, std::bind(&MailboxEventLoop::recv_comm_handler, this));
-    register_event_handler(MAILBOX_EVENT_RECV_COMM_END, std::bind(&MailboxEventLoop::recv_comm_complete_handler, this));
+ShmRecver::ShmRecver(zmq::context_t* zmq_context, const std::string& ring_name, size_t capacity,
+                     int num_event_loop_shards) {
+    ring_ = base::ShmRing::create(ring_name, capacity);
+    event_loop_connector_ = new EventLoopConnector(zmq_context, num_event_loop_shards);
+    recver_thread_ = new std::thread([&]() { serve(); });
+}
+
+ShmRecver::~ShmRecver() {
+    ring_->close();
+    recver_thread_->join();
+
+    delete recver_thread_;
+    delete event_loop_connector_;
+    delete ring_;
+}
+
+void ShmRecver::serve() {
+    std::vector<char> message;
+    while (ring_->read(&message)) {
+        // The same messages as CentralRecver receives, with a head of 4 ints, the last of which tells whether the
+        // stream is compressed, or the number of processes for a completion
+        int head[4];
+        std::memcpy(head, message.data(), sizeof(head));
+        if (head[0] == -2) {
+            event_loop_connector_->generate_in_comm_complete_event(head[1], head[2], head[3]);
+            continue;
+        }
+        auto* bin_stream_ptr = new BinStream(std::move(message));
+        bin_stream_ptr->seek(sizeof(head));
+        bin_stream_ptr->set_compressed(head[3] != 0);
+        event_loop_connector_->generate_in_comm_event(head[0], head[1], head[2], bin_stream_ptr);
+        message = std::vector<char>();
+    }
+}
+
+MailboxEventLoop::MailboxEventLoop(zmq::context_t* zmq_context, int num_shards) : zmq_context_(zmq_context) {
+    ASSERT_MSG(num_shards > 0, "The event loop needs at least one shard");
 
-    event_loop_thread_ = new std::thread([&]() { serve(); });
+    // register event handlers
+    register_event_handler(MAILBOX_EVENT_SEND_COMM,
+                           std::bind(&MailboxEventLoop::send_comm_handler, this, std::placeholders::_1));
+    register_event_handler(MAILBOX_EVENT_SEND_COMM_END,
+                           std::bind(&MailboxEventLoop::send_comm_complete_handler, this, std::placeholders::_1));
+    register_event_handler(MAILBOX_EVENT_SEND_COMM_ACK,
+                           std::bind(&MailboxEventLoop::send_comm_ack_handler, this, std::placeholders::_1));
+    register_event_handler(MAILBOX_EVENT_RECV_COMM,
+                           std::bind(&MailboxEventLoop::recv_comm_handler, this, std::placeholders::_1));
+    register_event_handler(MAILBOX_EVENT_RECV_COMM_END,
+                           std::bind(&MailboxEventLoop::recv_comm_complete_handler, this, std::placeholders::_1));
+
+    for (int i = 0; i < num_shards; ++i) {
+        shards_.emplace_back(new Shard(zmq_context_, i));
+        shards_.back()->event_recver.bind(event_loop_listen_address(i));
+    }
+    for (auto& shard : shards_) {
+        Shard* shard_ptr = shard.get();
+        shard->thread = new std::thread([this, shard_ptr]() { serve(*shard_ptr); });
+    }
 }
 
 MailboxEventLoop::~MailboxEventLoop() {
-    zmq::socket_t event_sender(*zmq_context_, ZMQ_PUSH);
-    event_sender.connect(kEventLoopListenAddress);
-    zmq_send_int32(&event_sender, MAILBOX_EVENT_DESTROY);
+    for (int i = 0; i < shards_.size(); ++i) {
+        zmq::socket_t event_sender(*zmq_context_, ZMQ_PUSH);
+        event_sender.connect(event_loop_listen_address(i));
+        zmq_send_int32(&event_sender, MAILBOX_EVENT_DESTROY);
+    }
 
-    event_loop_thread_->join();
-    delete event_loop_thread_;
-    for (auto& pair : sender_)
-        delete pair.second;
+    for (auto& shard : shards_) {
+        shard->thread->join();
+        delete shard->thread;
+        for (auto& pair : shard->sender)
+            for (auto* sender : pair.second)
+                delete sender;
+        for (auto& pair : shard->shm_sender)
+            delete pair.second;
+        for (auto& pair : shard->outgoing)
+            for (auto& msg : pair.second)
+                delete msg.bin_stream;
+    }
 }
 
-void MailboxEventLoop::serve() {
+void MailboxEventLoop::serve(Shard& shard) {
     while (true) {
-        int event_type = zmq_recv_int32(&event_recver_);
+        int event_type = zmq_recv_int32(&shard.event_recver);
         if (event_type == MAILBOX_EVENT_DESTROY)
             break;
         ASSERT_MSG(event_handler_.find(event_type) != event_handler_.end(), "Unknown event type.");
-        event_handler_[event_type]();
+        event_handler_[event_type](shard);
     }
 }
 
@@ -261,117 +408,255 @@ void MailboxEventLoop::register_mailbox(LocalMailbox& local_mailbox) {
 
     num_local_threads_ += 1;
     registered_mailbox_[tid] = &local_mailbox;
+    local_mailbox.event_loop_ = this;
+    // The mailbox sends to the shards of this event loop
+    local_mailbox.event_loop_connector_ = new EventLoopConnector(zmq_context_, get_num_shards());
 }
 
 void MailboxEventLoop::set_process_id(int process_id) { process_id_ = process_id; }
 
-void MailboxEventLoop::register_event_handler(int event_type, std::function<void()> handler) {
+void MailboxEventLoop::register_event_handler(int event_type, std::function<void(Shard&)> handler) {
     event_handler_[event_type] = handler;
 }
 
-void MailboxEventLoop::recv_comm_handler() {
-    int thread_id = zmq_recv_int32(&event_recver_);
-    int channel_id = zmq_recv_int32(&event_recver_);
-    int progress = zmq_recv_int32(&event_recver_);
-    BinStream* recv_bin_stream_ptr = reinterpret_cast<BinStream*>(zmq_recv_int64(&event_recver_));
+void MailboxEventLoop::recv_comm_handler(Shard& shard) {
+    int thread_id = zmq_recv_int32(&shard.event_recver);
+    int channel_id = zmq_recv_int32(&shard.event_recver);
+    int progress = zmq_recv_int32(&shard.event_recver);
+    BinStream* recv_bin_stream_ptr = reinterpret_cast<BinStream*>(zmq_recv_int64(&shard.event_recver));
+    int ack_process_id = zmq_recv_int32(&shard.event_recver);
+    int64_t recv_bytes = recv_bin_stream_ptr->size();
     _recv_comm_handler(thread_id, channel_id, progress, recv_bin_stream_ptr);
+    // The sender schedules its exchange and waits for the acknowledgement (see set_exchange_window)
+    if (ack_process_id != -1) {
+        auto* send_sock = shard.sender.at(ack_process_id).front();
+        int send_comm_ack_magic = -3;
+        zmq_sendmore_int32(send_sock, send_comm_ack_magic);
+        zmq_sendmore_int32(send_sock, channel_id);
+        zmq_sendmore_int32(send_sock, process_id_);
+        zmq_send_int64(send_sock, recv_bytes);
+    }
 }
 
 void MailboxEventLoop::_recv_comm_handler(int thread_id, int channel_id, int progress, BinStream* recv_bin_stream_ptr) {
-    ASSERT_MSG(registered_mailbox_.find(thread_id) != registered_mailbox_.end(),
+    // Shards look up the mailboxes concurrently, so never insert here
+    auto iter = registered_mailbox_.find(thread_id);
+    ASSERT_MSG(iter != registered_mailbox_.end(),
                ("[ERROR] Local mailbox for " + std::to_string(thread_id) + " does not exist").c_str());
 
-    auto& mailbox = *(registered_mailbox_[thread_id]);
-    {
-        std::lock_guard<std::mutex> cv_lock(mailbox.notify_lock_);
-        mailbox.in_queue_.get(channel_id, progress).push(std::move(recv_bin_stream_ptr));
-        mailbox.poll_cv_.notify_one();
-    }
+    auto& mailbox = *(iter->second);
+    mailbox.queued_bytes_ += recv_bin_stream_ptr->size();
+    mailbox.in_queue_.get(channel_id, progress).push(std::move(recv_bin_stream_ptr));
+    mailbox.notify_channel(channel_id);
     if (mailbox.comm_available_handler_)
         mailbox.comm_available_handler_(channel_id, progress);
 }
 
-void MailboxEventLoop::send_comm_handler() {
-    int thread_id = zmq_recv_int32(&event_recver_);
-    int channel_id = zmq_recv_int32(&event_recver_);
-    int progress = zmq_recv_int32(&event_recver_);
-    BinStream* bin_stream_ptr = reinterpret_cast<BinStream*>(zmq_recv_int64(&event_recver_));
-    _send_comm_handler(thread_id, channel_id, progress, bin_stream_ptr);
+void MailboxEventLoop::send_comm_handler(Shard& shard) {
+    int thread_id = zmq_recv_int32(&shard.event_recver);
+    int channel_id = zmq_recv_int32(&shard.event_recver);
+    int progress = zmq_recv_int32(&shard.event_recver);
+    BinStream* bin_stream_ptr = reinterpret_cast<BinStream*>(zmq_recv_int64(&shard.event_recver));
+    _send_comm_handler(shard, thread_id, channel_id, progress, bin_stream_ptr);
 }
 
-void MailboxEventLoop::_send_comm_handler(int thread_id, int channel_id, int progress, BinStream* send_bin_stream_ptr) {
-    int pid = tid_to_pid_[thread_id];
-    if (pid != process_id_) {
-        zmq_sendmore_int32(sender_[pid], thread_id);
-        zmq_sendmore_int32(sender_[pid], channel_id);
-        zmq_sendmore_int32(sender_[pid], progress);
-        zmq_send_binstream(sender_[pid], *send_bin_stream_ptr);
+void MailboxEventLoop::_send_comm_handler(Shard& shard, int thread_id, int channel_id, int progress,
+                                          BinStream* send_bin_stream_ptr) {
+    int pid = tid_to_pid_.at(thread_id);
+    auto* ring = pid != process_id_ ? get_shm_sender(shard, pid) : nullptr;
+    if (ring != nullptr) {
+        int head[] = {thread_id, channel_id, progress, send_bin_stream_ptr->is_compressed() ? 1 : 0};
+        ring->write(reinterpret_cast<const char*>(head), sizeof(head), send_bin_stream_ptr->get_remained_buffer(),
+                    send_bin_stream_ptr->size());
         delete send_bin_stream_ptr;
+    } else if (pid != process_id_) {
+        if (exchange_window_ == 0) {
+            send_to_peer(shard, pid, thread_id, channel_id, progress, send_bin_stream_ptr, false);
+        } else {
+            shard.outgoing[pid].push_back({thread_id, channel_id, progress, send_bin_stream_ptr});
+            shard.num_outgoing += 1;
+            shard.num_outgoing_of_channel[pid][std::make_pair(channel_id, progress)] += 1;
+            schedule_exchange(shard);
+        }
     } else {
-        // push it to the recv queue of the corresponding local mailbox
+        // push it to the recv queue of the corresponding local mailbox, in case the sender is not registered
         _recv_comm_handler(thread_id, channel_id, progress, send_bin_stream_ptr);
     }
 }
 
-void MailboxEventLoop::send_comm_complete_handler() {
-    int channel_id = zmq_recv_int32(&event_recver_);
-    int progress = zmq_recv_int32(&event_recver_);
-    int num_local_threads = zmq_recv_int32(&event_recver_);
-    auto* global_pids_ptr = reinterpret_cast<std::vector<int>*>(zmq_recv_int64(&event_recver_));
+void MailboxEventLoop::send_to_peer(Shard& shard, int process_id, int thread_id, int channel_id, int progress,
+                                    BinStream* send_bin_stream_ptr, bool need_ack) {
+    // Stripe the messages over the connections to the peer
+    auto& senders = shard.sender[process_id];
+    int& next_sender = shard.next_sender[process_id];
+    auto* send_sock = senders[next_sender];
+    next_sender = (next_sender + 1) % senders.size();
+    zmq_sendmore_int32(send_sock, thread_id);
+    zmq_sendmore_int32(send_sock, channel_id);
+    zmq_sendmore_int32(send_sock, progress);
+    zmq_sendmore_int32(send_sock, need_ack ? process_id_ : -1);
+    zmq_sendmore_int32(send_sock, send_bin_stream_ptr->is_compressed() ? 1 : 0);
+    zmq_send_binstream(send_sock, std::move(*send_bin_stream_ptr));
+    delete send_bin_stream_ptr;
+}
+
+void MailboxEventLoop::send_complete_to_peer(Shard& shard, int process_id, int channel_id, int progress,
+                                             int num_global_sync_processes) {
+    // Follow the messages on every connection, since they are not ordered across connections
+    int send_comm_complete_magic = -2;
+    auto& senders = shard.sender[process_id];
+    for (auto* send_sock : senders) {
+        zmq_sendmore_int32(send_sock, send_comm_complete_magic);
+        zmq_sendmore_int32(send_sock, channel_id);
+        zmq_sendmore_int32(send_sock, progress);
+        zmq_sendmore_int32(send_sock, num_global_sync_processes);
+        zmq_sendmore_int32(send_sock, process_id_);
+        zmq_send_int32(send_sock, static_cast<int>(senders.size()));
+    }
+}
+
+void MailboxEventLoop::set_exchange_window(size_t bytes) { exchange_window_ = bytes; }
+
+void MailboxEventLoop::schedule_exchange(Shard& shard) {
+    auto& order = shard.exchange_order;
+    if (order.empty()) {
+        // Each process goes through the peers starting from the next process id. When all the processes
+        // exchange at the same time, round r of process i sends to process i + r + 1 (modulo the number of
+        // processes), which receives from process i only.
+        int num_ids = process_id_ + 1;
+        for (auto& pair : shard.sender) {
+            if (pair.first == process_id_)
+                continue;
+            order.push_back(pair.first);
+            num_ids = std::max(num_ids, pair.first + 1);
+        }
+        std::sort(order.begin(), order.end(), [this, num_ids](int a, int b) {
+            return (a - process_id_ + num_ids) % num_ids < (b - process_id_ + num_ids) % num_ids;
+        });
+    }
+    while (true) {
+        int pid = order[shard.exchange_round];
+        auto& queue = shard.outgoing[pid];
+        auto& unacked_bytes = shard.unacked_bytes[pid];
+        while (!queue.empty() && shard.round_bytes < exchange_window_) {
+            Shard::Outgoing msg = queue.front();
+            queue.pop_front();
+            shard.num_outgoing -= 1;
+            unacked_bytes += msg.bin_stream->size();
+            shard.round_bytes += msg.bin_stream->size();
+            send_to_peer(shard, pid, msg.thread_id, msg.channel_id, msg.progress, msg.bin_stream, true);
+
+            // The completion of the (channel, progress) pair follows its last message
+            auto chnl_prgs_pair = std::make_pair(msg.channel_id, msg.progress);
+            auto& num_outgoing_of_channel = shard.num_outgoing_of_channel[pid];
+            auto iter = num_outgoing_of_channel.find(chnl_prgs_pair);
+            if (--iter->second != 0)
+                continue;
+            num_outgoing_of_channel.erase(iter);
+            auto& held_completions = shard.held_completions[pid];
+            auto held_iter = held_completions.find(chnl_prgs_pair);
+            if (held_iter != held_completions.end()) {
+                send_complete_to_peer(shard, pid, msg.channel_id, msg.progress, held_iter->second);
+                held_completions.erase(held_iter);
+            }
+        }
+        // Wait for the peer to acknowledge the round, or for more messages
+        if (unacked_bytes != 0 || shard.num_outgoing == 0)
+            return;
+        shard.exchange_round = (shard.exchange_round + 1) % order.size();
+        shard.round_bytes = 0;
+    }
+}
+
+void MailboxEventLoop::send_comm_ack_handler(Shard& shard) {
+    int channel_id = zmq_recv_int32(&shard.event_recver);
+    int process_id = zmq_recv_int32(&shard.event_recver);
+    int64_t acked_bytes = zmq_recv_int64(&shard.event_recver);
+    shard.unacked_bytes[process_id] -= acked_bytes;
+    schedule_exchange(shard);
+}
+
+void MailboxEventLoop::send_comm_complete_handler(Shard& shard) {
+    int channel_id = zmq_recv_int32(&shard.event_recver);
+    int progress = zmq_recv_int32(&shard.event_recver);
+    int num_local_threads = zmq_recv_int32(&shard.event_recver);
+    auto* global_pids_ptr = reinterpret_cast<std::vector<int>*>(zmq_recv_int64(&shard.event_recver));
     assert(global_pids_ptr->size() != 0);
-    _send_comm_complete_handler(channel_id, progress, num_local_threads, *global_pids_ptr);
+    _send_comm_complete_handler(shard, channel_id, progress, num_local_threads, *global_pids_ptr);
     delete global_pids_ptr;
 }
 
-void MailboxEventLoop::_send_comm_complete_handler(int channel_id, int progress, int num_local_threads,
+void MailboxEventLoop::_send_comm_complete_handler(Shard& shard, int channel_id, int progress, int num_local_threads,
                                                    const std::vector<int>& global_pids) {
     auto chnl_prgs_pair = std::make_pair(channel_id, progress);
-    if (send_comm_complete_counter_.find(chnl_prgs_pair) == send_comm_complete_counter_.end())
-        send_comm_complete_counter_[chnl_prgs_pair] = 0;
+    auto& send_comm_complete_counter = shard.send_comm_complete_counter;
+    if (send_comm_complete_counter.find(chnl_prgs_pair) == send_comm_complete_counter.end())
+        send_comm_complete_counter[chnl_prgs_pair] = 0;
 
     // TODO(Fan): I can actually skip before this event is generated
-    send_comm_complete_counter_[chnl_prgs_pair] += 1;
-    if (send_comm_complete_counter_[chnl_prgs_pair] == num_local_threads) {
+    send_comm_complete_counter[chnl_prgs_pair] += 1;
+    if (send_comm_complete_counter[chnl_prgs_pair] == num_local_threads) {
         bool involved_in_comm = false;
         for (auto pid : global_pids) {
             if (pid == process_id_) {
                 involved_in_comm = true;
                 continue;
             }
-            auto* send_sock = sender_[pid];
             int send_comm_complete_magic = -2;
-            zmq_sendmore_int32(send_sock, send_comm_complete_magic);
-            zmq_sendmore_int32(send_sock, channel_id);
-            zmq_sendmore_int32(send_sock, progress);
-            zmq_send_int32(send_sock, static_cast<int>(global_pids.size()));
+            auto* ring = get_shm_sender(shard, pid);
+            if (ring != nullptr) {
+                int head[] = {send_comm_complete_magic, channel_id, progress, static_cast<int>(global_pids.size())};
+                ring->write(reinterpret_cast<const char*>(head), sizeof(head), nullptr, 0);
+                continue;
+            }
+            if (exchange_window_ == 0 || shard.num_outgoing_of_channel[pid].count(chnl_prgs_pair) == 0) {
+                send_complete_to_peer(shard, pid, channel_id, progress, static_cast<int>(global_pids.size()));
+            } else {
+                // Keep the completion behind the messages of the same channel waiting for the exchange
+                shard.held_completions[pid][chnl_prgs_pair] = static_cast<int>(global_pids.size());
+            }
         }
         if (involved_in_comm)
-            _recv_comm_complete_handler(channel_id, progress, static_cast<int>(global_pids.size()));
-        send_comm_complete_counter_.erase(chnl_prgs_pair);
+            _recv_comm_complete_handler(shard, channel_id, progress, static_cast<int>(global_pids.size()));
+        send_comm_complete_counter.erase(chnl_prgs_pair);
     }
 }
 
-void MailboxEventLoop::recv_comm_complete_handler() {
-    int channel_id = zmq_recv_int32(&event_recver_);
-    int progress = zmq_recv_int32(&event_recver_);
-    int num_global_sync_proceses = zmq_recv_int32(&event_recver_);
-    _recv_comm_complete_handler(channel_id, progress, num_global_sync_proceses);
+void MailboxEventLoop::recv_comm_complete_handler(Shard& shard) {
+    int channel_id = zmq_recv_int32(&shard.event_recver);
+    int progress = zmq_recv_int32(&shard.event_recver);
+    int num_global_sync_proceses = zmq_recv_int32(&shard.event_recver);
+    int process_id = zmq_recv_int32(&shard.event_recver);
+    int num_connections = zmq_recv_int32(&shard.event_recver);
+    // A process with several connections to this one sends the completion through each of them,
+    // and its messages have all arrived once the completion arrives from every connection
+    if (num_connections > 1) {
+        auto chnl_prgs_pair = std::make_pair(channel_id, progress);
+        auto& counters = shard.recv_connection_complete_counter[chnl_prgs_pair];
+        if (++counters[process_id] < num_connections)
+            return;
+        counters.erase(process_id);
+        if (counters.empty())
+            shard.recv_connection_complete_counter.erase(chnl_prgs_pair);
+    }
+    _recv_comm_complete_handler(shard, channel_id, progress, num_global_sync_proceses);
 }
 
-void MailboxEventLoop::_recv_comm_complete_handler(int channel_id, int progress) {
-    _recv_comm_complete_handler(channel_id, progress, num_global_processes_);
+void MailboxEventLoop::_recv_comm_complete_handler(Shard& shard, int channel_id, int progress) {
+    _recv_comm_complete_handler(shard, channel_id, progress, num_global_processes_);
 }
 
-void MailboxEventLoop::_recv_comm_complete_handler(int channel_id, int progress, int num_global_sync_proceses) {
+void MailboxEventLoop::_recv_comm_complete_handler(Shard& shard, int channel_id, int progress,
+                                                   int num_global_sync_proceses) {
     auto chnl_prgs_pair = std::make_pair(channel_id, progress);
-    if (recv_comm_complete_counter_.find(chnl_prgs_pair) == recv_comm_complete_counter_.end())
-        recv_comm_complete_counter_[chnl_prgs_pair] = 0;
+    auto& recv_comm_complete_counter = shard.recv_comm_complete_counter;
+    if (recv_comm_complete_counter.find(chnl_prgs_pair) == recv_comm_complete_counter.end())
+        recv_comm_complete_counter[chnl_prgs_pair] = 0;
 
-    recv_comm_complete_counter_[chnl_prgs_pair] += 1;
-    if (recv_comm_complete_counter_[chnl_prgs_pair] == num_global_sync_proceses) {
+    recv_comm_complete_counter[chnl_prgs_pair] += 1;
+    if (recv_comm_complete_counter[chnl_prgs_pair] == num_global_sync_proceses) {
         for (auto& tid_mailbox_pair : registered_mailbox_) {
-            int thread_id = tid_mailbox_pair.first;
-            auto& mailbox = *(registered_mailbox_[thread_id]);
+            auto& mailbox = *(tid_mailbox_pair.second);
             {
                 std::lock_guard<std::mutex> cv_lock(mailbox.notify_lock_);
                 mailbox.comm_completed_.get(channel_id, progress) = true;
@@ -380,57 +665,107 @@ void MailboxEventLoop::_recv_comm_complete_handler(int channel_id, int progress,
             if (mailbox.comm_complete_handler_)
                 mailbox.comm_complete_handler_(channel_id, progress);
         }
-        recv_comm_complete_counter_.erase(chnl_prgs_pair);
+        recv_comm_complete_counter.erase(chnl_prgs_pair);
     }
 }
 
 void MailboxEventLoop::register_peer_recver(int process_id, const std::string& addr) {
-    ASSERT_MSG(sender_.count(process_id) == 0, "Register the same peer recver more than once");
-    sender_[process_id] = new zmq::socket_t(*zmq_context_, ZMQ_PUSH);
-    int linger = 4000;
-    sender_[process_id]->setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
-    sender_[process_id]->connect(addr);
+    register_peer_recver(process_id, std::vector<std::string>{addr});
+}
+
+void MailboxEventLoop::register_peer_recver(int process_id, const std::vector<std::string>& addrs) {
+    ASSERT_MSG(!addrs.empty(), "A peer recver needs at least one address");
+    for (auto& shard : shards_) {
+        ASSERT_MSG(shard->sender.count(process_id) == 0, "Register the same peer recver more than once");
+        // Each shard has its own sockets, since sockets cannot be shared among threads
+        for (auto& addr : addrs) {
+            auto* sender = new zmq::socket_t(*zmq_context_, ZMQ_PUSH);
+            int linger = 4000;
+            sender->setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+            sender->connect(addr);
+            shard->sender[process_id].push_back(sender);
+        }
+        shard->next_sender[process_id] = 0;
+    }
     num_global_processes_ += 1;
 }
 
 void MailboxEventLoop::register_peer_thread(int process_id, int thread_id) { tid_to_pid_[thread_id] = process_id; }
 
-EventLoopConnector::EventLoopConnector(zmq::context_t* zmq_context) : event_sender_(*zmq_context, ZMQ_PUSH) {
-    event_sender_.connect(kEventLoopListenAddress);
+void MailboxEventLoop::register_peer_shm(int process_id, const std::string& ring_prefix) {
+    ASSERT_MSG(process_id != process_id_, "Messages to the process itself do not go through shared memory");
+    shm_ring_prefix_[process_id] = ring_prefix;
+}
+
+base::ShmRing* MailboxEventLoop::get_shm_sender(Shard& shard, int process_id) {
+    auto iter = shard.shm_sender.find(process_id);
+    if (iter != shard.shm_sender.end())
+        return iter->second;
+    auto prefix = shm_ring_prefix_.find(process_id);
+    if (prefix == shm_ring_prefix_.end())
+        return nullptr;
+    // Wait for the peer to create the ring if it has not started yet, like a ZeroMQ connection would
+    auto* ring = base::ShmRing::open(shm_ring_name(prefix->second, process_id_, process_id, shard.id));
+    shard.shm_sender[process_id] = ring;
+    return ring;
+}
+
+EventLoopConnector::EventLoopConnector(zmq::context_t* zmq_context, int num_event_loop_shards) {
+    ASSERT_MSG(num_event_loop_shards > 0, "The event loop needs at least one shard");
+    for (int i = 0; i < num_event_loop_shards; ++i) {
+        event_senders_.emplace_back(new zmq::socket_t(*zmq_context, ZMQ_PUSH));
+        event_senders_.back()->connect(event_loop_listen_address(i));
+    }
+}
+
+void EventLoopConnector::generate_in_comm_event(int thread_id, int channel_id, int progress, BinStream* bin_stream_ptr,
+                                                int ack_process_id) {
+    auto* sock = event_sender(channel_id);
+    zmq_sendmore_int32(sock, MAILBOX_EVENT_RECV_COMM);
+    zmq_sendmore_int32(sock, thread_id);
+    zmq_sendmore_int32(sock, channel_id);
+    zmq_sendmore_int32(sock, progress);
+    zmq_sendmore_int64(sock, reinterpret_cast<uint64_t>(bin_stream_ptr));
+    zmq_send_int32(sock, ack_process_id);
 }
 
-void EventLoopConnector::generate_in_comm_event(int thread_id, int channel_id, int progress,
-                                                BinStream* bin_stream_ptr) {
-    zmq_sendmore_int32(&event_sender_, MAILBOX_EVENT_RECV_COMM);
-    zmq_sendmore_int32(&event_sender_, thread_id);
-    zmq_sendmore_int32(&event_sender_, channel_id);
-    zmq_sendmore_int32(&event_sender_, progress);
-    zmq_send_int64(&event_sender_, reinterpret_cast<uint64_t>(bin_stream_ptr));
+void EventLoopConnector::generate_out_comm_ack_event(int channel_id, int process_id, int64_t acked_bytes) {
+    auto* sock = event_sender(channel_id);
+    zmq_sendmore_int32(sock, MAILBOX_EVENT_SEND_COMM_ACK);
+    zmq_sendmore_int32(sock, channel_id);
+    zmq_sendmore_int32(sock, process_id);
+    zmq_send_int64(sock, acked_bytes);
 }
 
-void EventLoopConnector::generate_in_comm_complete_event(int channel_id, int progress, int num_global_sync_proceses) {
-    zmq_sendmore_int32(&event_sender_, MAILBOX_EVENT_RECV_COMM_END);
-    zmq_sendmore_int32(&event_sender_, channel_id);
-    zmq_sendmore_int32(&event_sender_, progress);
-    zmq_send_int32(&event_sender_, num_global_sync_proceses);
+void EventLoopConnector::generate_in_comm_complete_event(int channel_id, int progress, int num_global_sync_proceses,
+                                                         int process_id, int num_connections) {
+    auto* sock = event_sender(channel_id);
+    zmq_sendmore_int32(sock, MAILBOX_EVENT_RECV_COMM_END);
+    zmq_sendmore_int32(sock, channel_id);
+    zmq_sendmore_int32(sock, progress);
+    zmq_sendmore_int32(sock, num_global_sync_proceses);
+    zmq_sendmore_int32(sock, process_id);
+    zmq_send_int32(sock, num_connections);
 }
 
 void EventLoopConnector::generate_out_comm_event(int thread_id, int channel_id, int progress, BinStream& bin_stream) {
-    zmq_sendmore_int32(&event_sender_, MAILBOX_EVENT_SEND_COMM);
-    zmq_sendmore_int32(&event_sender_, thread_id);
-    zmq_sendmore_int32(&event_sender_, channel_id);
-    zmq_sendmore_int32(&event_sender_, progress);
+    auto* sock = event_sender(channel_id);
+    zmq_sendmore_int32(sock, MAILBOX_EVENT_SEND_COMM);
+    zmq_sendmore_int32(sock, thread_id);
+    zmq_sendmore_int32(sock, channel_id);
+    zmq_sendmore_int32(sock, progress);
     auto* bin_stream_ptr = new BinStream(std::move(bin_stream));
-    zmq_send_int64(&event_sender_, reinterpret_cast<uint64_t>(bin_stream_ptr));
+    zmq_send_int64(sock, reinterpret_cast<uint64_t>(bin_stream_ptr));
 }
 
 void EventLoopConnector::generate_out_comm_complete_event(int channel_id, int progress, int num_local_sender_threads,
                                                           std::vector<int>* global_pids_ptr) {
-    zmq_sendmore_int32(&event_sender_, MAILBOX_EVENT_SEND_COMM_END);
-    zmq_sendmore_int32(&event_sender_, channel_id);
-    zmq_sendmore_int32(&event_sender_, progress);
-    zmq_sendmore_int32(&event_sender_, num_local_sender_threads);
-    zmq_send_int64(&event_sender_, reinterpret_cast<uint64_t>(global_pids_ptr));
+    auto* sock = event_sender(channel_id);
+    zmq_sendmore_int32(sock, MAILBOX_EVENT_SEND_COMM_END);
+    zmq_sendmore_int32(sock, channel_id);
+    zmq_sendmore_int32(sock, progress);
+    zmq_sendmore_int32(sock, num_local_sender_threads);
+    zmq_send_int64(sock, reinterpret_cast<uint64_t>(global_pids_ptr));
 }
 
 }  // namespace husky
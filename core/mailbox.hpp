@@ -14,26 +14,33 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "zmq.hpp"
 
+#include "base/compression.hpp"
 #include "base/concurrent_channel_store.hpp"
-#include "base/concurrent_queue.hpp"
+#include "base/mpsc_queue.hpp"
 #include "base/hash.hpp"
 #include "base/serialization.hpp"
+#include "base/shm_ring.hpp"
 #include "core/hash_ring.hpp"
 
 namespace husky {
 
 using base::BinStream;
 using base::ConcurrentChannelStore;
-using base::ConcurrentQueue;
+using base::MPSCQueue;
 
 class EventLoopConnector;
 class MailboxEventLoop;
@@ -106,6 +113,10 @@ class LocalMailbox {
     /// that, the `send_complete` method should be used to indicate the end of this
     /// batch of communication.
     ///
+    /// A BinStream to a thread of the same process is pushed into the mailbox of
+    /// that thread directly instead of going through the event loop. It is queued
+    /// before `send_complete` returns, so the completion still follows it.
+    ///
     /// @param thread_id ID of the destination worker thread.
     /// @param channel_id ID of the Channel for the communication.
     /// @param progress Progress of the communication. Progress should always
@@ -136,10 +147,40 @@ class LocalMailbox {
     /// @return The actual incoming communication in the form of BinStream.
     BinStream recv(int channel_id, int progress);
 
+    /// \brief Compress the BinStreams of a Channel to other hosts
+    ///
+    /// The BinStreams of at least `min_bytes` bytes are compressed with `codec` before they are sent to
+    /// a process on another host. The messages tell whether they are compressed, so `recv` restores them
+    /// whether or not the receiving mailbox sets a codec for the Channel.
+    ///
+    /// @param channel_id ID of the Channel.
+    /// @param codec The codec, which is_compression_available(). CompressionCodec::None turns it off.
+    /// @param min_bytes Smaller BinStreams are not worth compressing.
+    void set_compression(int channel_id, base::CompressionCodec codec, size_t min_bytes);
+
+    /// \brief Receive the BinStreams of a Channel as compact streams
+    ///
+    /// `recv` returns compact BinStreams (see BinStream::set_compact) for the Channel, whose senders write
+    /// compact streams as well.
+    void set_compact_serialization(int channel_id, bool compact);
+
+    /// \brief Number of incoming BinStreams that are queued but not yet received
+    ///
+    /// @param channel_id ID of the Channel in interest.
+    /// @param progress Progress of the Channel in interest.
+    /// @return The number of BinStreams that `recv` can return without waiting.
+    int get_queue_depth(int channel_id, int progress);
+
+    /// \brief Total bytes of incoming BinStreams queued in this mailbox but not yet received
+    ///
+    /// It covers all Channels and progresses, so a worker can tell how far it lags behind its senders.
+    inline size_t get_queued_bytes() const { return queued_bytes_; }
+
     /// \brief Set the handler for new incoming communication
     ///
     /// The handler will be apply once there's new incoming communication available
-    /// (in the form of BinStream).
+    /// (in the form of BinStream). It runs in the event loop or in the local sender
+    /// thread, so it should be thread-safe.
     ///
     /// @param handler The handler to use
     void set_comm_available_handler(std::function<void(int channel_id, int progress)> handler) {
@@ -159,24 +200,43 @@ class LocalMailbox {
     friend class MailboxEventLoop;
 
    protected:
+    // Block until the predicate holds. Senders to `channel_id` (or any channel for kWaitingAnyChannel) wake it up.
+    void wait_for_channel(int channel_id, const std::function<bool()>& pred);
+    // Return false if the predicate still does not hold after `timeout` seconds
+    bool wait_for_channel(int channel_id, const std::function<bool()>& pred, double timeout);
+    // Wake up the owner if it waits for the channel
+    void notify_channel(int channel_id);
+    // Free the BinStreams left in the cell of a completed progress, so that the cell can be reused
+    void reset_progress(int channel_id, int progress);
+
     int thread_id_;
     int process_id_ = 0;
     zmq::context_t* zmq_context_;
+    // Set when registered, to deliver to the other mailboxes of the process directly
+    MailboxEventLoop* event_loop_ = nullptr;
+    // Senders only take notify_lock_ to wake up the owner when it waits for their channel
     std::condition_variable poll_cv_;
     std::mutex notify_lock_;
+    std::atomic<int> waiting_channel_{kNotWaiting};
+    static const int kNotWaiting = -1;
+    static const int kWaitingAnyChannel = -2;
     std::function<void(int, int)> comm_available_handler_;
     std::function<void(int, int)> comm_complete_handler_;
 
-    ConcurrentChannelStore<ConcurrentQueue<BinStream*>> in_queue_;
+    ConcurrentChannelStore<MPSCQueue<BinStream*>> in_queue_;
+    std::atomic<size_t> queued_bytes_{0};
+    // The codec and the minimum size to compress for each Channel which set_compression()
+    std::unordered_map<int, std::pair<base::CompressionCodec, size_t>> compression_;
+    std::unordered_set<int> compact_channels_;
     ConcurrentChannelStore<bool> comm_completed_;
-    ConcurrentChannelStore<std::mutex> poll_mutex_;
-    EventLoopConnector* event_loop_connector_;
+    // Created when registered, with the number of shards of the event loop
+    EventLoopConnector* event_loop_connector_ = nullptr;
 };
 
 class CentralRecver {
    public:
-    // Create the recver thread and recver socket
-    CentralRecver(zmq::context_t* zmq_context, const std::string& bind_addr);
+    // Create the recver thread and recver socket, which passes messages to an event loop of `num_event_loop_shards`
+    CentralRecver(zmq::context_t* zmq_context, const std::string& bind_addr, int num_event_loop_shards = 1);
 
     // Join the thread and free resources
     virtual ~CentralRecver();
@@ -191,59 +251,167 @@ class CentralRecver {
     EventLoopConnector* event_loop_connector_;
 };
 
-class MailboxEventLoop {
+/// Name of the shared-memory ring from process `src_pid` to process `dst_pid` used by event loop shard `shard`
+std::string shm_ring_name(const std::string& prefix, int src_pid, int dst_pid, int shard);
+
+/// \brief Receive the messages which a process on the same host sends through shared memory
+///
+/// It creates the ring of one event loop shard of the sender, and passes the messages to the
+/// event loop as CentralRecver does.
+class ShmRecver {
    public:
-    // Create the event loop thread and the send socket
-    explicit MailboxEventLoop(zmq::context_t* zmq_context);
+    // Create the ring and the recver thread, which passes messages to an event loop of `num_event_loop_shards`
+    ShmRecver(zmq::context_t* zmq_context, const std::string& ring_name, size_t capacity,
+              int num_event_loop_shards = 1);
+
     // Join the thread and free resources
+    virtual ~ShmRecver();
+
+   protected:
+    void serve();
+
+    base::ShmRing* ring_;
+    std::thread* recver_thread_;
+    EventLoopConnector* event_loop_connector_;
+};
+
+/// \brief Dispatch the communication events of the local mailboxes
+///
+/// The events are served by `num_shards` threads. Each Channel is served by shard
+/// (channel_id % num_shards), so the messages and the completion of a (channel, progress)
+/// pair keep their order within one shard, while different Channels are served in parallel.
+/// The event loop must be created before the LocalMailbox and CentralRecver of the process,
+/// whose connectors connect to every shard.
+class MailboxEventLoop {
+   public:
+    // Create the event loop threads and the send sockets
+    explicit MailboxEventLoop(zmq::context_t* zmq_context, int num_shards = 1);
+    // Join the threads and free resources
     virtual ~MailboxEventLoop();
 
     void register_mailbox(LocalMailbox& local_mailbox);
     void set_process_id(int process_id);
     void register_peer_recver(int process_id, const std::string& addr);
+    /// Connect to the peer once for each address, and stripe the messages to the peer over the connections
+    void register_peer_recver(int process_id, const std::vector<std::string>& addrs);
     void register_peer_thread(int process_id, int thread_id);
-    void register_event_handler(int event_type, std::function<void()> handler);
+    /// \brief Send to a process on the same host through shared memory instead of its recver
+    ///
+    /// The rings are named by shm_ring_name(ring_prefix, ...) and are created by the ShmRecvers
+    /// of the peer. Each shard opens its ring when it first sends to the peer.
+    void register_peer_shm(int process_id, const std::string& ring_prefix);
+
+    /// \brief Schedule the messages to the peers as an all-to-all exchange in rounds
+    ///
+    /// Instead of sending every message to the peers at once, each shard goes through the peers in the
+    /// order of their process ids, starting from the next process, and only sends to the peer of the current
+    /// round. A round sends at most `bytes` bytes to its peer and ends when the peer has acknowledged them,
+    /// so a process has messages in flight to one peer at a time. Peers without messages are skipped, and
+    /// the completion of a channel follows the last message of the channel to the peer right away. Since all
+    /// the processes follow the same order, a process mostly receives from one peer at a time, which avoids
+    /// incast after a superstep. 0 (the default) sends every message at once.
+    void set_exchange_window(size_t bytes);
+
+    inline int get_num_shards() const { return shards_.size(); }
+
+    friend class LocalMailbox;
 
    protected:
-    void recv_comm_handler();
+    // The sockets and completion counters of a shard, which are only accessed by its thread
+    struct Shard {
+        Shard(zmq::context_t* zmq_context, int id) : event_recver(*zmq_context, ZMQ_PULL), id(id) {}
+        zmq::socket_t event_recver;
+        int id;
+        std::unordered_map<int, std::vector<zmq::socket_t*>> sender;
+        std::unordered_map<int, int> next_sender;
+        std::unordered_map<int, base::ShmRing*> shm_sender;
+        std::unordered_map<std::pair<int, int>, int> send_comm_complete_counter;
+        std::unordered_map<std::pair<int, int>, int> recv_comm_complete_counter;
+        // The connections of each peer which delivered the completion of a (channel, progress) pair so far
+        std::unordered_map<std::pair<int, int>, std::unordered_map<int, int>> recv_connection_complete_counter;
+
+        // Messages to each peer waiting for its round of the exchange
+        struct Outgoing {
+            int thread_id;
+            int channel_id;
+            int progress;
+            BinStream* bin_stream;
+        };
+        std::unordered_map<int, std::deque<Outgoing>> outgoing;
+        size_t num_outgoing = 0;
+        // The number of messages in outgoing of each (channel, progress) pair, per peer
+        std::unordered_map<int, std::unordered_map<std::pair<int, int>, int>> num_outgoing_of_channel;
+        // The completions to each peer which follow the messages in outgoing, with num_global_sync_processes
+        std::unordered_map<int, std::unordered_map<std::pair<int, int>, int>> held_completions;
+        std::unordered_map<int, size_t> unacked_bytes;
+        std::vector<int> exchange_order;
+        // The current round sends to exchange_order[exchange_round]
+        size_t exchange_round = 0;
+        size_t round_bytes = 0;
+        std::thread* thread = nullptr;
+    };
+
+    void register_event_handler(int event_type, std::function<void(Shard&)> handler);
+
+    void recv_comm_handler(Shard& shard);
     void _recv_comm_handler(int thread_id, int channel_id, int progress, BinStream* recv_bin_stream_ptr);
-    void send_comm_handler();
-    void _send_comm_handler(int thread_id, int channel_id, int progress, BinStream* send_bin_stream_ptr);
-    void send_comm_complete_handler();
-    void _send_comm_complete_handler(int channel_id, int progress, int num_local_threads,
+    void send_comm_handler(Shard& shard);
+    void _send_comm_handler(Shard& shard, int thread_id, int channel_id, int progress,
+                            BinStream* send_bin_stream_ptr);
+    void send_to_peer(Shard& shard, int process_id, int thread_id, int channel_id, int progress,
+                      BinStream* send_bin_stream_ptr, bool need_ack);
+    void send_complete_to_peer(Shard& shard, int process_id, int channel_id, int progress,
+                               int num_global_sync_processes);
+    // Send to the peer of the current round, and go on to the next rounds once the peer acknowledges a window
+    // of bytes or has nothing left to send
+    void schedule_exchange(Shard& shard);
+    void send_comm_ack_handler(Shard& shard);
+    void send_comm_complete_handler(Shard& shard);
+    void _send_comm_complete_handler(Shard& shard, int channel_id, int progress, int num_local_threads,
                                      const std::vector<int>& global_pids);
-    void recv_comm_complete_handler();
-    void _recv_comm_complete_handler(int channel_id, int progress);
-    void _recv_comm_complete_handler(int channel_id, int progress, int num_global_sync_processes);
+    void recv_comm_complete_handler(Shard& shard);
+    void _recv_comm_complete_handler(Shard& shard, int channel_id, int progress);
+    void _recv_comm_complete_handler(Shard& shard, int channel_id, int progress, int num_global_sync_processes);
 
-    void serve();
+    void serve(Shard& shard);
+    // The ring of the shard to the process, or nullptr if the process is not reached through shared memory
+    base::ShmRing* get_shm_sender(Shard& shard, int process_id);
 
     zmq::context_t* zmq_context_;
-    zmq::socket_t event_recver_;
+    std::vector<std::unique_ptr<Shard>> shards_;
     std::unordered_map<int, LocalMailbox*> registered_mailbox_;
-    std::unordered_map<int, zmq::socket_t*> sender_;
     std::unordered_map<int, int> tid_to_pid_;
-    std::unordered_map<int, std::function<void()>> event_handler_;
-    std::unordered_map<std::pair<int, int>, int> send_comm_complete_counter_;
-    std::unordered_map<std::pair<int, int>, int> recv_comm_complete_counter_;
-    std::thread* event_loop_thread_;
+    std::unordered_map<int, std::string> shm_ring_prefix_;
+    std::unordered_map<int, std::function<void(Shard&)>> event_handler_;
     int num_local_threads_ = 0;
     int num_global_processes_ = 1;
     int process_id_ = -1;
+    size_t exchange_window_ = 0;
 };
 
 class EventLoopConnector {
    public:
-    explicit EventLoopConnector(zmq::context_t* zmq_context);
-
-    void generate_in_comm_event(int thread_id, int channel_id, int progress, BinStream* bin_stream);
-    void generate_in_comm_complete_event(int channel_id, int progress, int num_global_sync_proceses);
+    // Connect to the shards of the event loop in the context, which must agree with the event loop
+    EventLoopConnector(zmq::context_t* zmq_context, int num_event_loop_shards);
+
+    // The event loop acknowledges the message to process `ack_process_id` unless it is -1
+    void generate_in_comm_event(int thread_id, int channel_id, int progress, BinStream* bin_stream,
+                                int ack_process_id = -1);
+    void generate_out_comm_ack_event(int channel_id, int process_id, int64_t acked_bytes);
+    // `num_connections` is the number of connections from process `process_id`, each delivering the completion
+    void generate_in_comm_complete_event(int channel_id, int progress, int num_global_sync_proceses,
+                                         int process_id = -1, int num_connections = 1);
     void generate_out_comm_event(int thread_id, int channel_id, int progress, BinStream& bin_stream);
     void generate_out_comm_complete_event(int channel_id, int progress, int num_local_sender_threads,
                                           std::vector<int>* global_pids_ptr);
 
    protected:
-    zmq::socket_t event_sender_;
+    // The socket to the event loop shard serving the channel
+    inline zmq::socket_t* event_sender(int channel_id) {
+        return event_senders_[channel_id % event_senders_.size()].get();
+    }
+
+    std::vector<std::unique_ptr<zmq::socket_t>> event_senders_;
 };
 
 }  // namespace husky
@@ -1,3 +1,8 @@
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -162,6 +167,69 @@ TEST_F(TestMailbox, SendRecvMultiple) {
     assert(recv_float == static_cast<float>(4.19));
 }
 
+TEST_F(TestMailbox, QueueDepth) {
+    zmq::context_t zmq_context;
+
+    // Setup
+    MailboxEventLoop el(&zmq_context);
+    el.set_process_id(0);
+    CentralRecver recver(&zmq_context, "inproc://test");
+    LocalMailbox mailbox(&zmq_context);
+    mailbox.set_thread_id(0);
+    el.register_mailbox(mailbox);
+
+    // send two messages
+    for (int i = 0; i < 2; i++) {
+        BinStream send_bin_stream;
+        send_bin_stream << i;
+        mailbox.send(0, 0, 0, send_bin_stream);
+    }
+    mailbox.send_complete(0, 0, {0}, {0});
+
+    // Both are queued once the communication completes
+    EXPECT_TRUE(mailbox.poll(0, 0));
+    while (mailbox.get_queue_depth(0, 0) < 2)
+        mailbox.poll(0, 0);
+    EXPECT_EQ(mailbox.get_queued_bytes(), 2 * sizeof(int));
+
+    mailbox.recv(0, 0);
+    EXPECT_EQ(mailbox.get_queue_depth(0, 0), 1);
+    EXPECT_EQ(mailbox.get_queued_bytes(), sizeof(int));
+    mailbox.recv(0, 0);
+    EXPECT_FALSE(mailbox.poll(0, 0));
+    EXPECT_EQ(mailbox.get_queue_depth(0, 0), 0);
+    EXPECT_EQ(mailbox.get_queued_bytes(), 0);
+}
+
+TEST_F(TestMailbox, StaleProgress) {
+    zmq::context_t zmq_context;
+
+    // Setup
+    MailboxEventLoop el(&zmq_context);
+    el.set_process_id(0);
+    CentralRecver recver(&zmq_context, "inproc://test");
+    LocalMailbox mailbox(&zmq_context);
+    mailbox.set_thread_id(0);
+    el.register_mailbox(mailbox);
+
+    // Leave two messages of progress 0 unreceived
+    for (int i = 0; i < 2; i++) {
+        BinStream send_bin_stream;
+        send_bin_stream << i;
+        mailbox.send(0, 0, 0, send_bin_stream);
+    }
+    mailbox.send_complete(0, 0, {0}, {0});
+    while (mailbox.get_queue_depth(0, 0) < 2)
+        mailbox.poll(0, 0);
+    EXPECT_EQ(mailbox.get_queued_bytes(), 2 * sizeof(int));
+
+    // Polling the next progress to its end reuses the cell of progress 0 and frees the messages left in it
+    mailbox.send_complete(0, 1, {0}, {0});
+    EXPECT_FALSE(mailbox.poll(0, 1));
+    EXPECT_EQ(mailbox.get_queue_depth(0, 0), 0);
+    EXPECT_EQ(mailbox.get_queued_bytes(), 0);
+}
+
 TEST_F(TestMailbox, Multithread) {
     zmq::context_t zmq_context;
 
@@ -201,6 +269,87 @@ TEST_F(TestMailbox, Multithread) {
     assert(recv_float == static_cast<float>(4.19));
 }
 
+TEST_F(TestMailbox, DirectLocalDelivery) {
+    zmq::context_t zmq_context;
+
+    // Setup
+    MailboxEventLoop el(&zmq_context);
+    el.set_process_id(0);
+    CentralRecver recver(&zmq_context, "inproc://test");
+    LocalMailbox mailbox_0(&zmq_context);
+    mailbox_0.set_thread_id(0);
+    el.register_mailbox(mailbox_0);
+    LocalMailbox mailbox_1(&zmq_context);
+    mailbox_1.set_thread_id(1);
+    el.register_mailbox(mailbox_1);
+
+    // The message is queued as soon as it is sent
+    BinStream send_bin_stream;
+    send_bin_stream << 419;
+    mailbox_1.send(0, 0, 0, send_bin_stream);
+    EXPECT_EQ(mailbox_0.get_queue_depth(0, 0), 1);
+    EXPECT_EQ(send_bin_stream.size(), 0);
+
+    mailbox_1.send_complete(0, 0, {0, 1}, {0});
+    mailbox_0.send_complete(0, 0, {0, 1}, {0});
+    EXPECT_TRUE(mailbox_0.poll(0, 0));
+    BinStream recv_bin_stream = mailbox_0.recv(0, 0);
+    int recv_int;
+    recv_bin_stream >> recv_int;
+    EXPECT_EQ(recv_int, 419);
+    EXPECT_FALSE(mailbox_0.poll(0, 0));
+    EXPECT_FALSE(mailbox_1.poll(0, 0));
+}
+
+TEST_F(TestMailbox, ShardedEventLoop) {
+    zmq::context_t zmq_context;
+
+    // Setup
+    MailboxEventLoop el(&zmq_context, 4);
+    EXPECT_EQ(el.get_num_shards(), 4);
+    el.set_process_id(0);
+    CentralRecver recver(&zmq_context, "inproc://test", el.get_num_shards());
+    LocalMailbox mailbox_0(&zmq_context);
+    mailbox_0.set_thread_id(0);
+    el.register_mailbox(mailbox_0);
+    LocalMailbox mailbox_1(&zmq_context);
+    mailbox_1.set_thread_id(1);
+    el.register_mailbox(mailbox_1);
+
+    // Each thread sends to the other on channels served by different shards
+    std::vector<LocalMailbox*> mailboxes{&mailbox_0, &mailbox_1};
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < 2; ++tid) {
+        threads.emplace_back([&, tid]() {
+            auto& mailbox = *mailboxes[tid];
+            for (int progress = 0; progress < 3; ++progress) {
+                for (int channel_id = 0; channel_id < 8; ++channel_id) {
+                    for (int i = 0; i < 10; ++i) {
+                        BinStream send_bin_stream;
+                        send_bin_stream << channel_id << i;
+                        mailbox.send(1 - tid, channel_id, progress, send_bin_stream);
+                    }
+                    mailbox.send_complete(channel_id, progress, {0, 1}, {0});
+                }
+                for (int channel_id = 0; channel_id < 8; ++channel_id) {
+                    int count = 0;
+                    while (mailbox.poll(channel_id, progress)) {
+                        BinStream recv_bin_stream = mailbox.recv(channel_id, progress);
+                        int recv_channel_id, recv_i;
+                        recv_bin_stream >> recv_channel_id >> recv_i;
+                        EXPECT_EQ(recv_channel_id, channel_id);
+                        EXPECT_EQ(recv_i, count);
+                        count += 1;
+                    }
+                    EXPECT_EQ(count, 10);
+                }
+            }
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+}
+
 TEST_F(TestMailbox, TwoProcesses) {
     // Setup thread 0 on process 0
     zmq::context_t zmq_context_0;
@@ -255,6 +404,309 @@ TEST_F(TestMailbox, TwoProcesses) {
     assert(recv_float == static_cast<float>(4.19));
 }
 
+TEST_F(TestMailbox, MultipleConnections) {
+    // Setup thread 0 on process 0
+    zmq::context_t zmq_context_0;
+    MailboxEventLoop el_0(&zmq_context_0);
+    el_0.set_process_id(0);
+    CentralRecver recver_0_0(&zmq_context_0, "ipc://test-conn-0-0");
+    CentralRecver recver_0_1(&zmq_context_0, "ipc://test-conn-0-1");
+    LocalMailbox mailbox_0(&zmq_context_0);
+    mailbox_0.set_thread_id(0);
+    el_0.register_mailbox(mailbox_0);
+
+    // Setup thread 1 on process 1
+    zmq::context_t zmq_context_1;
+    MailboxEventLoop el_1(&zmq_context_1);
+    el_1.set_process_id(1);
+    CentralRecver recver_1_0(&zmq_context_1, "ipc://test-conn-1-0");
+    CentralRecver recver_1_1(&zmq_context_1, "ipc://test-conn-1-1");
+    LocalMailbox mailbox_1(&zmq_context_1);
+    mailbox_1.set_thread_id(1);
+    el_1.register_mailbox(mailbox_1);
+
+    // Connect twice to each peer
+    el_0.register_peer_recver(1, std::vector<std::string>{"ipc://test-conn-1-0", "ipc://test-conn-1-1"});
+    el_0.register_peer_thread(1, 1);
+    el_1.register_peer_recver(0, std::vector<std::string>{"ipc://test-conn-0-0", "ipc://test-conn-0-1"});
+    el_1.register_peer_thread(0, 0);
+
+    // The messages are striped over both connections, and the completion waits for all of them
+    const int kNumMessages = 10;
+    for (int progress = 0; progress < 3; ++progress) {
+        for (int i = 0; i < kNumMessages; ++i) {
+            BinStream send_bin_stream;
+            send_bin_stream << i;
+            mailbox_0.send(1, 0, progress, send_bin_stream);
+        }
+        mailbox_0.send_complete(0, progress, {0}, {0, 1});
+        mailbox_1.send_complete(0, progress, {1}, {0, 1});
+
+        EXPECT_FALSE(mailbox_0.poll(0, progress));
+        int sum = 0;
+        for (int i = 0; i < kNumMessages; ++i) {
+            ASSERT_TRUE(mailbox_1.poll(0, progress));
+            BinStream recv_bin_stream = mailbox_1.recv(0, progress);
+            int recv_int;
+            recv_bin_stream >> recv_int;
+            sum += recv_int;
+        }
+        EXPECT_FALSE(mailbox_1.poll(0, progress));
+        EXPECT_EQ(sum, kNumMessages * (kNumMessages - 1) / 2);
+    }
+}
+
+TEST_F(TestMailbox, ExchangeScheduling) {
+    // Setup thread i on process i, with a window which only lets one message to a peer be unacknowledged
+    const int kNumProcesses = 3;
+    std::vector<std::unique_ptr<zmq::context_t>> zmq_contexts;
+    std::vector<std::unique_ptr<MailboxEventLoop>> event_loops;
+    std::vector<std::unique_ptr<CentralRecver>> recvers;
+    std::vector<std::unique_ptr<LocalMailbox>> mailboxes;
+    for (int i = 0; i < kNumProcesses; ++i) {
+        zmq_contexts.emplace_back(new zmq::context_t());
+        event_loops.emplace_back(new MailboxEventLoop(zmq_contexts[i].get()));
+        event_loops[i]->set_process_id(i);
+        event_loops[i]->set_exchange_window(1);
+        recvers.emplace_back(new CentralRecver(zmq_contexts[i].get(), "ipc://test-exchange-" + std::to_string(i)));
+        mailboxes.emplace_back(new LocalMailbox(zmq_contexts[i].get()));
+        mailboxes[i]->set_thread_id(i);
+        event_loops[i]->register_mailbox(*mailboxes[i]);
+    }
+    for (int i = 0; i < kNumProcesses; ++i) {
+        for (int j = 0; j < kNumProcesses; ++j) {
+            if (i == j)
+                continue;
+            event_loops[i]->register_peer_recver(j, "ipc://test-exchange-" + std::to_string(j));
+            event_loops[i]->register_peer_thread(j, j);
+        }
+    }
+
+    // Every process sends to all the others, and the completion follows the messages waiting for the exchange
+    const int kNumMessages = 10;
+    std::vector<int> pids = {0, 1, 2};
+    for (int progress = 0; progress < 2; ++progress) {
+        for (int i = 0; i < kNumProcesses; ++i) {
+            for (int j = 0; j < kNumProcesses; ++j) {
+                if (i == j)
+                    continue;
+                for (int k = 0; k < kNumMessages; ++k) {
+                    BinStream send_bin_stream;
+                    send_bin_stream << i << k;
+                    mailboxes[i]->send(j, 0, progress, send_bin_stream);
+                }
+            }
+        }
+        for (int i = 0; i < kNumProcesses; ++i)
+            mailboxes[i]->send_complete(0, progress, {i}, pids);
+
+        for (int j = 0; j < kNumProcesses; ++j) {
+            std::vector<int> sums(kNumProcesses, 0);
+            for (int n = 0; n < (kNumProcesses - 1) * kNumMessages; ++n) {
+                ASSERT_TRUE(mailboxes[j]->poll(0, progress));
+                BinStream recv_bin_stream = mailboxes[j]->recv(0, progress);
+                int src, k;
+                recv_bin_stream >> src >> k;
+                sums[src] += k;
+            }
+            EXPECT_FALSE(mailboxes[j]->poll(0, progress));
+            for (int i = 0; i < kNumProcesses; ++i)
+                EXPECT_EQ(sums[i], i == j ? 0 : kNumMessages * (kNumMessages - 1) / 2);
+        }
+    }
+}
+
+TEST_F(TestMailbox, ExchangeRounds) {
+    // Setup thread 0 on process 0 and thread 2 on process 2, while process 1 comes up later
+    zmq::context_t zmq_context_0;
+    MailboxEventLoop el_0(&zmq_context_0);
+    el_0.set_process_id(0);
+    el_0.set_exchange_window(1);
+    CentralRecver recver_0(&zmq_context_0, "ipc://test-rounds-0");
+    LocalMailbox mailbox_0(&zmq_context_0);
+    mailbox_0.set_thread_id(0);
+    el_0.register_mailbox(mailbox_0);
+
+    zmq::context_t zmq_context_2;
+    MailboxEventLoop el_2(&zmq_context_2);
+    el_2.set_process_id(2);
+    CentralRecver recver_2(&zmq_context_2, "ipc://test-rounds-2");
+    LocalMailbox mailbox_2(&zmq_context_2);
+    mailbox_2.set_thread_id(2);
+    el_2.register_mailbox(mailbox_2);
+
+    el_0.register_peer_recver(1, "ipc://test-rounds-1");
+    el_0.register_peer_thread(1, 1);
+    el_0.register_peer_recver(2, "ipc://test-rounds-2");
+    el_0.register_peer_thread(2, 2);
+    el_2.register_peer_recver(0, "ipc://test-rounds-0");
+    el_2.register_peer_thread(0, 0);
+    el_2.register_peer_recver(1, "ipc://test-rounds-1");
+    el_2.register_peer_thread(1, 1);
+
+    // The first round of process 0 sends to process 1, and process 2 waits for its round
+    for (int k = 0; k < 3; ++k) {
+        BinStream send_bin_stream;
+        send_bin_stream << k;
+        mailbox_0.send(1, 0, 0, send_bin_stream);
+    }
+    BinStream send_bin_stream;
+    send_bin_stream << 3;
+    mailbox_0.send(2, 0, 0, send_bin_stream);
+    std::vector<int> pids = {0, 1, 2};
+    mailbox_0.send_complete(0, 0, {0}, pids);
+    mailbox_2.send_complete(0, 0, {2}, pids);
+    EXPECT_FALSE(mailbox_2.poll_with_timeout(0, 0, 0.2));
+
+    // Once process 1 acknowledges the round, process 2 gets its turn
+    zmq::context_t zmq_context_1;
+    MailboxEventLoop el_1(&zmq_context_1);
+    el_1.set_process_id(1);
+    CentralRecver recver_1(&zmq_context_1, "ipc://test-rounds-1");
+    LocalMailbox mailbox_1(&zmq_context_1);
+    mailbox_1.set_thread_id(1);
+    el_1.register_mailbox(mailbox_1);
+    el_1.register_peer_recver(0, "ipc://test-rounds-0");
+    el_1.register_peer_thread(0, 0);
+    el_1.register_peer_recver(2, "ipc://test-rounds-2");
+    el_1.register_peer_thread(2, 2);
+    mailbox_1.send_complete(0, 0, {1}, pids);
+
+    ASSERT_TRUE(mailbox_2.poll(0, 0));
+    BinStream recv_bin_stream = mailbox_2.recv(0, 0);
+    int recv_int;
+    recv_bin_stream >> recv_int;
+    EXPECT_EQ(recv_int, 3);
+    EXPECT_FALSE(mailbox_2.poll(0, 0));
+    for (int k = 0; k < 3; ++k) {
+        ASSERT_TRUE(mailbox_1.poll(0, 0));
+        BinStream recv_bin_stream = mailbox_1.recv(0, 0);
+        recv_bin_stream >> recv_int;
+        EXPECT_EQ(recv_int, k);
+    }
+    EXPECT_FALSE(mailbox_1.poll(0, 0));
+    EXPECT_FALSE(mailbox_0.poll(0, 0));
+}
+
+TEST_F(TestMailbox, Compression) {
+    auto codec = base::CompressionCodec::None;
+    for (auto c : {base::CompressionCodec::LZ4, base::CompressionCodec::Zstd})
+        if (base::is_compression_available(c))
+            codec = c;
+
+    // Setup thread 0 and 2 on process 0
+    zmq::context_t zmq_context_0;
+    MailboxEventLoop el_0(&zmq_context_0);
+    el_0.set_process_id(0);
+    CentralRecver recver_0(&zmq_context_0, "ipc://test-compression-0");
+    LocalMailbox mailbox_0(&zmq_context_0);
+    mailbox_0.set_thread_id(0);
+    el_0.register_mailbox(mailbox_0);
+    LocalMailbox mailbox_2(&zmq_context_0);
+    mailbox_2.set_thread_id(2);
+    el_0.register_mailbox(mailbox_2);
+
+    // Setup thread 1 on process 1
+    zmq::context_t zmq_context_1;
+    MailboxEventLoop el_1(&zmq_context_1);
+    el_1.set_process_id(1);
+    CentralRecver recver_1(&zmq_context_1, "ipc://test-compression-1");
+    LocalMailbox mailbox_1(&zmq_context_1);
+    mailbox_1.set_thread_id(1);
+    el_1.register_mailbox(mailbox_1);
+
+    el_0.register_peer_recver(1, "ipc://test-compression-1");
+    el_0.register_peer_thread(1, 1);
+    el_1.register_peer_recver(0, "ipc://test-compression-0");
+    el_1.register_peer_thread(0, 0);
+    el_1.register_peer_thread(0, 2);
+    // Only the sender sets the codec, since the messages tell whether they are compressed
+    mailbox_0.set_compression(0, codec, 1024);
+
+    // Both the large and the small streams come back as they were sent, to the local thread as well
+    std::string large(100000, 'a');
+    for (int dst : {1, 2}) {
+        BinStream large_bin_stream;
+        large_bin_stream << large;
+        mailbox_0.send(dst, 0, 0, large_bin_stream);
+        BinStream small_bin_stream;
+        small_bin_stream << 42;
+        mailbox_0.send(dst, 0, 0, small_bin_stream);
+    }
+    mailbox_0.send_complete(0, 0, {0, 2}, {0, 1});
+    mailbox_2.send_complete(0, 0, {0, 2}, {0, 1});
+    mailbox_1.send_complete(0, 0, {1}, {0, 1});
+
+    for (auto* mailbox : {&mailbox_1, &mailbox_2}) {
+        int num_large = 0, num_small = 0;
+        while (mailbox->poll(0, 0)) {
+            BinStream recv_bin_stream = mailbox->recv(0, 0);
+            if (recv_bin_stream.size() == sizeof(int)) {
+                int recv_int;
+                recv_bin_stream >> recv_int;
+                EXPECT_EQ(recv_int, 42);
+                num_small += 1;
+            } else {
+                std::string recv_str;
+                recv_bin_stream >> recv_str;
+                EXPECT_EQ(recv_str, large);
+                num_large += 1;
+            }
+        }
+        EXPECT_EQ(num_large, 1);
+        EXPECT_EQ(num_small, 1);
+    }
+    EXPECT_FALSE(mailbox_0.poll(0, 0));
+}
+
+TEST_F(TestMailbox, SharedMemory) {
+    std::string prefix = "/husky-test-mailbox-" + std::to_string(getpid());
+
+    // Setup thread 0 on process 0
+    zmq::context_t zmq_context_0;
+    MailboxEventLoop el_0(&zmq_context_0);
+    el_0.set_process_id(0);
+    CentralRecver recver_0(&zmq_context_0, "ipc://test-shm-0");
+    ShmRecver shm_recver_0(&zmq_context_0, shm_ring_name(prefix, 1, 0, 0), 1 << 10);
+    LocalMailbox mailbox_0(&zmq_context_0);
+    mailbox_0.set_thread_id(0);
+    el_0.register_mailbox(mailbox_0);
+
+    // Setup thread 1 on process 1
+    zmq::context_t zmq_context_1;
+    MailboxEventLoop el_1(&zmq_context_1);
+    el_1.set_process_id(1);
+    CentralRecver recver_1(&zmq_context_1, "ipc://test-shm-1");
+    ShmRecver shm_recver_1(&zmq_context_1, shm_ring_name(prefix, 0, 1, 0), 1 << 10);
+    LocalMailbox mailbox_1(&zmq_context_1);
+    mailbox_1.set_thread_id(1);
+    el_1.register_mailbox(mailbox_1);
+
+    // Connect through shared memory
+    el_0.register_peer_recver(1, "ipc://test-shm-1");
+    el_0.register_peer_thread(1, 1);
+    el_0.register_peer_shm(1, prefix);
+    el_1.register_peer_recver(0, "ipc://test-shm-0");
+    el_1.register_peer_thread(0, 0);
+    el_1.register_peer_shm(0, prefix);
+
+    // A message larger than the rings
+    BinStream send_bin_stream;
+    std::vector<int> send_vec(1000, 419);
+    send_bin_stream << send_vec;
+    mailbox_0.send(1, 0, 0, send_bin_stream);
+    mailbox_0.send_complete(0, 0, {0}, {0, 1});
+    mailbox_1.send_complete(0, 0, {1}, {0, 1});
+
+    EXPECT_FALSE(mailbox_0.poll(0, 0));
+    ASSERT_TRUE(mailbox_1.poll(0, 0));
+    BinStream recv_bin_stream = mailbox_1.recv(0, 0);
+    EXPECT_FALSE(mailbox_1.poll(0, 0));
+    std::vector<int> recv_vec;
+    recv_bin_stream >> recv_vec;
+    EXPECT_EQ(recv_vec, send_vec);
+}
+
 TEST_F(TestMailbox, Iterative) {
     // Setup thread 0 on process 0
     zmq::context_t zmq_context_0;
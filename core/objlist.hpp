@@ -16,7 +16,9 @@
 
 #include <algorithm>
 #include <functional>
+#include <memory>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -25,10 +27,13 @@
 #include "base/assert.hpp"
 #include "base/disk_store.hpp"
 #include "base/exception.hpp"
+#include "base/hash.hpp"
 #include "base/serialization.hpp"
 #include "core/attrlist.hpp"
 #include "core/channel/channel_destination.hpp"
 #include "core/channel/channel_source.hpp"
+#include "core/hash_ring.hpp"
+#include "core/partitioner.hpp"
 
 namespace husky {
 
@@ -60,6 +65,74 @@ class ObjListBase : public ChannelSource, public ChannelDestination {
     static thread_local size_t s_counter;
 };
 
+namespace detail {
+
+// Index from the keys of the objects not in the sorted part of an ObjList to their positions.
+// key_at(idx) returns the key of the object at idx.
+template <typename KeyT>
+class HashedObjIndex {
+   public:
+    template <typename KeyAtT>
+    inline void set(const KeyT& key, size_t idx, KeyAtT key_at) {
+        index_[key] = idx;
+    }
+
+    template <typename KeyRefT, typename KeyAtT>
+    inline bool find(const KeyRefT& key, KeyAtT key_at, size_t* idx) const {
+        auto iter = index_.find(static_cast<KeyT>(key));
+        if (iter == index_.end())
+            return false;
+        *idx = iter->second;
+        return true;
+    }
+
+    inline size_t size() const { return index_.size(); }
+    inline void clear() { index_.clear(); }
+
+   private:
+    std::unordered_map<KeyT, size_t> index_;
+};
+
+// String keys are indexed by the hash of their bytes and compared with the keys in the list, so that a view
+// of a key (base::StringRef) is looked up without building a std::string
+template <>
+class HashedObjIndex<std::string> {
+   public:
+    template <typename KeyAtT>
+    inline void set(const std::string& key, size_t idx, KeyAtT key_at) {
+        uint64_t hash = base::hash_bytes(key.data(), key.size());
+        auto range = index_.equal_range(hash);
+        for (auto iter = range.first; iter != range.second; ++iter) {
+            if (key_at(iter->second) == key) {
+                iter->second = idx;
+                return;
+            }
+        }
+        index_.emplace(hash, idx);
+    }
+
+    template <typename KeyRefT, typename KeyAtT>
+    inline bool find(const KeyRefT& key, KeyAtT key_at, size_t* idx) const {
+        base::StringRef ref(key);
+        auto range = index_.equal_range(base::hash_bytes(ref.data(), ref.size()));
+        for (auto iter = range.first; iter != range.second; ++iter) {
+            if (key_at(iter->second) == ref) {
+                *idx = iter->second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline size_t size() const { return index_.size(); }
+    inline void clear() { index_.clear(); }
+
+   private:
+    std::unordered_multimap<uint64_t, size_t> index_;
+};
+
+}  // namespace detail
+
 template <typename ObjT>
 class ObjList : public ObjListBase {
    public:
@@ -150,9 +223,10 @@ class ObjList : public ObjListBase {
         return idx;
     }
 
-    // Find obj according to key
+    // Find obj according to key, which may also be a view of the key type such as base::StringRef
     // @Return a pointer to obj
-    ObjT* find(const typename ObjT::KeyT& key) {
+    template <typename KeyRefT>
+    ObjT* find(const KeyRefT& key) {
         auto& working_list = objlist_data_.data_;
         if (working_list.size() == 0)
             return nullptr;
@@ -170,7 +244,7 @@ class ObjList : public ObjListBase {
 #endif
             // __builtin_prefetch(&working_list[(m+1+r)/2], 0, 1);
             // __builtin_prefetch(&working_list[(l+m-1)/2], 0, 1);
-            auto tmp = start_addr[m].id();
+            const auto& tmp = start_addr[m].id();
             if (tmp == key)
                 return &working_list[m];
             else if (tmp < key)
@@ -181,8 +255,11 @@ class ObjList : public ObjListBase {
         }
 
         // The object to find is not in the sorted part
-        if ((sorted_size_ < objlist_data_.data_.size()) && (hashed_objs_.find(key) != hashed_objs_.end()))
-            return &(objlist_data_.data_[hashed_objs_[key]]);
+        if (sorted_size_ < objlist_data_.data_.size()) {
+            size_t idx;
+            if (hashed_objs_.find(key, key_at(), &idx))
+                return &(objlist_data_.data_[idx]);
+        }
         return nullptr;
     }
 
@@ -192,14 +269,16 @@ class ObjList : public ObjListBase {
     // Add an object
     size_t add_object(ObjT&& obj) {
         auto& data = objlist_data_.data_;
-        size_t ret = hashed_objs_[obj.id()] = data.size();
+        size_t ret = data.size();
+        hashed_objs_.set(obj.id(), ret, key_at());
         data.push_back(std::move(obj));
         del_bitmap_.push_back(0);
         return ret;
     }
     size_t add_object(const ObjT& obj) {
         auto& data = objlist_data_.data_;
-        size_t ret = hashed_objs_[obj.id()] = data.size();
+        size_t ret = data.size();
+        hashed_objs_.set(obj.id(), ret, key_at());
         data.push_back(obj);
         del_bitmap_.push_back(0);
         return ret;
@@ -246,6 +325,59 @@ class ObjList : public ObjListBase {
                 item.second->process_bin(bin, idx);
     }
 
+    // Serialize the attributes of an object into one BinStream per AttrList. New columns are compact streams
+    // if `compact` is set.
+    void migrate_attribute(std::vector<BinStream>& columns, const size_t idx, bool compact = false) {
+        if (columns.size() < this->attrlist_map.size()) {
+            size_t num_columns = columns.size();
+            columns.resize(this->attrlist_map.size());
+            for (size_t i = num_columns; i < columns.size(); ++i)
+                columns[i].set_compact(compact);
+        }
+        size_t i = 0;
+        for (auto& item : this->attrlist_map)
+            item.second->migrate(columns[i++], idx);
+    }
+
+    // Read the attribute columns of `num` objects starting from idx, in the order of migrate_attribute
+    void process_attribute(BinStream& bin, const size_t idx, const size_t num) {
+        for (auto& item : this->attrlist_map)
+            item.second->process_bin(bin, idx, num);
+    }
+
+    // Append `num` objects which are serialized contiguously
+    // @Return the index of the first appended object
+    size_t process_objects(BinStream& bin, const size_t num) {
+        auto& data = objlist_data_.data_;
+        size_t start = data.size();
+        data.resize(start + num);
+        base::deserialize_range(bin, data.data() + start, num);
+        del_bitmap_.resize(start + num, false);
+        for (size_t i = start; i < start + num; ++i)
+            hashed_objs_.set(data[i].id(), i, key_at());
+        return start;
+    }
+
+    // Route the channels to this list and globalize() by partitioner, which all workers must set alike.
+    // Lists sharing a partitioner are co-partitioned. nullptr restores hashing over the hash ring.
+    void set_partitioner(std::shared_ptr<Partitioner<typename ObjT::KeyT>> partitioner) {
+        partitioner_ = std::move(partitioner);
+    }
+
+    inline const std::shared_ptr<Partitioner<typename ObjT::KeyT>>& get_partitioner() const { return partitioner_; }
+
+    // @Return the global id of the worker owning key, by the partitioner if set or else by hash_ring
+    inline int lookup_partition(const typename ObjT::KeyT& key, const HashRing& hash_ring) const {
+        return partitioner_ == nullptr ? hash_ring.hash_lookup(key) : partitioner_->lookup(key);
+    }
+
+    // Whether an object of this list and an object of other list with the same key live on the same worker
+    template <typename OtherObjT>
+    bool is_copartitioned_with(const ObjList<OtherObjT>& other) const {
+        return std::is_same<typename ObjT::KeyT, typename OtherObjT::KeyT>::value &&
+               static_cast<const void*>(partitioner_.get()) == static_cast<const void*>(other.get_partitioner().get());
+    }
+
     inline size_t get_sorted_size() const { return sorted_size_; }
     inline size_t get_num_del() const { return objlist_data_.num_del_; }
     inline size_t get_hashed_size() const { return hashed_objs_.size(); }
@@ -308,10 +440,16 @@ class ObjList : public ObjListBase {
     }
 
    protected:
+    // The key of the object at an index, for hashed_objs_
+    inline auto key_at() const {
+        return [this](size_t idx) -> decltype(auto) { return objlist_data_.data_[idx].id(); };
+    }
+
     ObjListData<ObjT> objlist_data_;
     size_t sorted_size_ = 0;
     std::vector<bool> del_bitmap_;
-    std::unordered_map<typename ObjT::KeyT, size_t> hashed_objs_;
+    detail::HashedObjIndex<typename ObjT::KeyT> hashed_objs_;
     std::unordered_map<std::string, AttrListBase*> attrlist_map;
+    std::shared_ptr<Partitioner<typename ObjT::KeyT>> partitioner_;
 };
 }  // namespace husky
@@ -1,11 +1,15 @@
 #include "core/objlist.hpp"
 
 #include <algorithm>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "gtest/gtest.h"
 
+#include "core/hash_ring.hpp"
+#include "core/partitioner.hpp"
+
 namespace husky {
 namespace {
 
@@ -113,6 +117,62 @@ TEST_F(TestObjList, Find) {
     EXPECT_EQ(obj_list.find(10), nullptr);
 }
 
+class StringObj {
+   public:
+    using KeyT = std::string;
+    KeyT key;
+    const KeyT& id() const { return key; }
+    StringObj() {}
+    explicit StringObj(const KeyT& k) : key(k) {}
+};
+
+TEST_F(TestObjList, FindByStringRef) {
+    ObjList<StringObj> obj_list;
+    for (int i = 0; i < 10; ++i)
+        obj_list.add_object(StringObj(std::to_string(i)));
+    obj_list.sort();
+    obj_list.add_object(StringObj("hashed"));
+    obj_list.add_object(StringObj("a key longer than a word"));
+    obj_list.add_object(StringObj(""));
+    for (std::string key : {"0", "9", "hashed", "a key longer than a word", ""}) {
+        auto* obj = obj_list.find(base::StringRef(key));
+        ASSERT_NE(obj, nullptr);
+        EXPECT_EQ(obj->id(), key);
+        EXPECT_EQ(obj_list.find(key), obj);
+    }
+    EXPECT_EQ(obj_list.find(base::StringRef("10")), nullptr);
+    EXPECT_EQ(obj_list.find(base::StringRef("a key longer than a wore")), nullptr);
+    EXPECT_EQ(obj_list.get_hashed_size(), 3);
+
+    // Adding a key again indexes the new object
+    size_t idx = obj_list.add_object(StringObj("hashed"));
+    EXPECT_EQ(obj_list.get_hashed_size(), 3);
+    EXPECT_EQ(obj_list.index_of(obj_list.find(base::StringRef("hashed"))), idx);
+}
+
+TEST_F(TestObjList, Partitioner) {
+    HashRing hash_ring;
+    hash_ring.insert(0);
+    hash_ring.insert(1);
+    ObjList<Obj> obj_list, other_list;
+    EXPECT_TRUE(obj_list.get_partitioner() == nullptr);
+    EXPECT_TRUE(obj_list.is_copartitioned_with(other_list));
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(obj_list.lookup_partition(i, hash_ring), hash_ring.hash_lookup(i));
+
+    auto partitioner = std::make_shared<RangePartitioner<int>>(std::vector<int>{5}, std::vector<int>{1, 0});
+    obj_list.set_partitioner(partitioner);
+    EXPECT_FALSE(obj_list.is_copartitioned_with(other_list));
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(obj_list.lookup_partition(i, hash_ring), i < 5 ? 1 : 0);
+
+    other_list.set_partitioner(partitioner);
+    EXPECT_TRUE(obj_list.is_copartitioned_with(other_list));
+
+    obj_list.set_partitioner(nullptr);
+    EXPECT_EQ(obj_list.lookup_partition(3, hash_ring), hash_ring.hash_lookup(3));
+}
+
 TEST_F(TestObjList, IndexOf) {
     ObjList<Obj> obj_list;
     for (int i = 0; i < 10; ++i) {
@@ -0,0 +1,114 @@
+// Copyright 2016 Husky Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "base/assert.hpp"
+#include "core/hash_ring.hpp"
+
+namespace husky {
+
+/// \brief Map the keys of the objects in an ObjList to the global ids of the worker threads owning them
+///
+/// A partitioner set on an ObjList routes the channels to the list and globalize(). ObjLists sharing a
+/// partitioner are co-partitioned, so objects with the same key live on the same worker. Every worker must
+/// set an equivalent partitioner on its own part of the list.
+template <typename KeyT>
+class Partitioner {
+   public:
+    virtual ~Partitioner() = default;
+
+    /// @Return the global id of the worker owning key
+    virtual int lookup(const KeyT& key) const = 0;
+};
+
+/// Hash the keys over a hash ring, which may cover only a subset of the workers
+template <typename KeyT>
+class HashPartitioner : public Partitioner<KeyT> {
+   public:
+    explicit HashPartitioner(const HashRing& hash_ring) : hash_ring_(hash_ring) {}
+
+    int lookup(const KeyT& key) const override { return hash_ring_.hash_lookup(key); }
+
+   protected:
+    HashRing hash_ring_;
+};
+
+/// \brief Assign consecutive key ranges to workers
+///
+/// Keys smaller than bounds[0] go to tids[0], and keys in [bounds[i - 1], bounds[i]) go to tids[i].
+/// So there is one more tid than bounds, and bounds must be sorted.
+template <typename KeyT>
+class RangePartitioner : public Partitioner<KeyT> {
+   public:
+    RangePartitioner(std::vector<KeyT> bounds, std::vector<int> tids)
+        : bounds_(std::move(bounds)), tids_(std::move(tids)) {
+        ASSERT_MSG(tids_.size() == bounds_.size() + 1, "RangePartitioner needs one more tid than bounds");
+        ASSERT_MSG(std::is_sorted(bounds_.begin(), bounds_.end()), "RangePartitioner bounds are not sorted");
+    }
+
+    int lookup(const KeyT& key) const override {
+        return tids_[std::upper_bound(bounds_.begin(), bounds_.end(), key) - bounds_.begin()];
+    }
+
+   protected:
+    std::vector<KeyT> bounds_;
+    std::vector<int> tids_;
+};
+
+/// Look the keys up in an explicit table, and fall back to another partitioner for the keys not in it
+template <typename KeyT>
+class TablePartitioner : public Partitioner<KeyT> {
+   public:
+    explicit TablePartitioner(std::shared_ptr<Partitioner<KeyT>> fallback) : fallback_(std::move(fallback)) {
+        ASSERT_MSG(fallback_ != nullptr, "TablePartitioner needs a fallback partitioner");
+    }
+
+    int lookup(const KeyT& key) const override {
+        auto iter = table_.find(key);
+        return iter == table_.end() ? fallback_->lookup(key) : iter->second;
+    }
+
+    inline void set(const KeyT& key, int tid) { table_[key] = tid; }
+
+    inline void reserve(size_t num_keys) { table_.reserve(num_keys); }
+
+    inline size_t size() const { return table_.size(); }
+
+   protected:
+    std::unordered_map<KeyT, int> table_;
+    std::shared_ptr<Partitioner<KeyT>> fallback_;
+};
+
+/// Use a user function, e.g., for keys which are pre-partitioned by their high bits
+template <typename KeyT>
+class FunctionPartitioner : public Partitioner<KeyT> {
+   public:
+    explicit FunctionPartitioner(std::function<int(const KeyT&)> func) : func_(std::move(func)) {}
+
+    int lookup(const KeyT& key) const override { return func_(key); }
+
+   protected:
+    std::function<int(const KeyT&)> func_;
+};
+
+}  // namespace husky
@@ -0,0 +1,68 @@
+#include "core/partitioner.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "core/hash_ring.hpp"
+
+namespace husky {
+namespace {
+
+class TestPartitioner : public testing::Test {
+   public:
+    TestPartitioner() {}
+    ~TestPartitioner() {}
+
+   protected:
+    void SetUp() {}
+    void TearDown() {}
+};
+
+TEST_F(TestPartitioner, Hash) {
+    HashRing hash_ring;
+    hash_ring.insert(3);
+    hash_ring.insert(7);
+    HashPartitioner<int> partitioner(hash_ring);
+    for (int i = 0; i < 100; i++)
+        EXPECT_EQ(partitioner.lookup(i), hash_ring.hash_lookup(i));
+}
+
+TEST_F(TestPartitioner, Range) {
+    RangePartitioner<int> partitioner({10, 20, 20, 30}, {4, 3, 2, 1, 0});
+    EXPECT_EQ(partitioner.lookup(-5), 4);
+    EXPECT_EQ(partitioner.lookup(9), 4);
+    EXPECT_EQ(partitioner.lookup(10), 3);
+    EXPECT_EQ(partitioner.lookup(19), 3);
+    // The empty range [20, 20) owns no key
+    EXPECT_EQ(partitioner.lookup(20), 1);
+    EXPECT_EQ(partitioner.lookup(30), 0);
+
+    RangePartitioner<std::string> str_partitioner({"m"}, {0, 1});
+    EXPECT_EQ(str_partitioner.lookup("apple"), 0);
+    EXPECT_EQ(str_partitioner.lookup("zebra"), 1);
+}
+
+TEST_F(TestPartitioner, Table) {
+    auto fallback = std::make_shared<FunctionPartitioner<int>>([](const int& key) { return -1; });
+    TablePartitioner<int> partitioner(fallback);
+    partitioner.set(1, 5);
+    partitioner.set(2, 6);
+    partitioner.set(1, 7);
+    EXPECT_EQ(partitioner.size(), 2);
+    EXPECT_EQ(partitioner.lookup(1), 7);
+    EXPECT_EQ(partitioner.lookup(2), 6);
+    EXPECT_EQ(partitioner.lookup(3), -1);
+}
+
+TEST_F(TestPartitioner, Function) {
+    // Keys pre-partitioned by their high bits
+    FunctionPartitioner<uint64_t> partitioner([](const uint64_t& key) { return static_cast<int>(key >> 48); });
+    EXPECT_EQ(partitioner.lookup(0x0001000000000005ULL), 1);
+    EXPECT_EQ(partitioner.lookup(0x0003000000000001ULL), 3);
+}
+
+}  // namespace
+}  // namespace husky
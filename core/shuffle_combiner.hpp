@@ -15,12 +15,13 @@
 #pragma once
 
 #include <atomic>
-#include <string>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "base/serialization.hpp"
-#include "base/thread_support.hpp"
-#include "core/zmq_helpers.hpp"
 
 namespace husky {
 
@@ -47,6 +48,104 @@ class Shuffler {
     CollectT* collection_ = nullptr;
 };
 
+/// ShuffleReadyRings tells local workers which peers have their shuffle buffers ready.
+///
+/// Each local worker owns a bounded lock-free ring, into which the other workers push their local ids.
+/// Producers claim slots with an atomic counter and every slot carries a sequence number, so that
+/// pushing and popping only touch shared memory. A thread that keeps waiting on a slot stops spinning
+/// and sleeps on the ring's condition variable, which is only signalled when someone is asleep.
+class ShuffleReadyRings {
+   public:
+    explicit ShuffleReadyRings(int num_local_workers) : num_rings_(num_local_workers) {
+        // Room for two rounds of num_local_workers - 1 pushes. A push into a full ring waits for its owner
+        while (capacity_ < 2 * num_rings_)
+            capacity_ <<= 1;
+        slots_.reset(new Slot[num_rings_ * capacity_]);
+        tails_.reset(new std::atomic<size_t>[num_rings_]);
+        heads_.reset(new size_t[num_rings_]);
+        sleepers_.reset(new Sleepers[num_rings_]);
+        for (int i = 0; i < num_rings_; ++i) {
+            tails_[i].store(0, std::memory_order_relaxed);
+            sleepers_[i].num_sleeping.store(0, std::memory_order_relaxed);
+            heads_[i] = 0;
+            for (size_t j = 0; j < capacity_; ++j)
+                slots_[i * capacity_ + j].seq.store(j, std::memory_order_relaxed);
+        }
+    }
+
+    ShuffleReadyRings(const ShuffleReadyRings&) = delete;
+    ShuffleReadyRings& operator=(const ShuffleReadyRings&) = delete;
+
+    /// Tell the owner of ring `ring_id` that `worker_id` is ready
+    void push(int ring_id, int worker_id) {
+        size_t pos = tails_[ring_id].fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots_[ring_id * capacity_ + (pos & (capacity_ - 1))];
+        wait_for(ring_id, slot, pos);
+        slot.worker_id = worker_id;
+        publish(ring_id, slot, pos + 1);
+    }
+
+    /// Wait for the next ready worker. Only the owner of ring `ring_id` can pop from it
+    int pop(int ring_id) {
+        size_t pos = heads_[ring_id]++;
+        Slot& slot = slots_[ring_id * capacity_ + (pos & (capacity_ - 1))];
+        wait_for(ring_id, slot, pos + 1);
+        int worker_id = slot.worker_id;
+        publish(ring_id, slot, pos + capacity_);
+        return worker_id;
+    }
+
+   protected:
+    struct Slot {
+        std::atomic<size_t> seq;
+        int worker_id;
+    };
+
+    struct Sleepers {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::atomic<int> num_sleeping;
+    };
+
+    static const int kNumSpins = 1024;
+    static const int kNumYields = 64;
+
+    void wait_for(int ring_id, const Slot& slot, size_t seq) {
+        for (int spin = 0; spin < kNumSpins + kNumYields; ++spin) {
+            if (slot.seq.load(std::memory_order_acquire) == seq)
+                return;
+            if (spin >= kNumSpins)
+                std::this_thread::yield();
+        }
+        // Announce ourselves before the last check, so that publish() either sees a sleeper or we see its store
+        Sleepers& sleepers = sleepers_[ring_id];
+        sleepers.num_sleeping.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(sleepers.mutex);
+            sleepers.cv.wait(lock, [&]() { return slot.seq.load(std::memory_order_seq_cst) == seq; });
+        }
+        sleepers.num_sleeping.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void publish(int ring_id, Slot& slot, size_t seq) {
+        slot.seq.store(seq, std::memory_order_seq_cst);
+        Sleepers& sleepers = sleepers_[ring_id];
+        if (sleepers.num_sleeping.load(std::memory_order_seq_cst) > 0) {
+            // Taking the lock orders the notification after a sleeper's last check of its slot
+            std::lock_guard<std::mutex> lock(sleepers.mutex);
+            sleepers.cv.notify_all();
+        }
+    }
+
+    int num_rings_;
+    size_t capacity_ = 1;
+    std::unique_ptr<Slot[]> slots_;
+    std::unique_ptr<std::atomic<size_t>[]> tails_;
+    // Only accessed by the owner of each ring
+    std::unique_ptr<size_t[]> heads_;
+    std::unique_ptr<Sleepers[]> sleepers_;
+};
+
 template <typename CellT>
 class ShuffleCombiner {
    protected:
@@ -57,8 +156,7 @@ class ShuffleCombiner {
 
     ShuffleCombiner(ShuffleCombiner&& sc) {
         messages_ = std::move(sc.messages_);
-        publisher_ = sc.publisher_;
-        subscriber_ = sc.subscriber_;
+        ready_rings_ = sc.ready_rings_;
         num_units_ = sc.num_units_;
         num_local_workers_ = sc.num_local_workers_;
         channel_id_ = sc.channel_id_;
@@ -67,80 +165,39 @@ class ShuffleCombiner {
         sc.num_local_workers_ = 0;
         sc.channel_id_ = -1;
         sc.local_id_ = -1;
-        sc.publisher_ = nullptr;
-        sc.subscriber_ = nullptr;
+        sc.ready_rings_ = nullptr;
     }
 
-    virtual ~ShuffleCombiner() {
-        messages_.clear();
-        delete publisher_;
-        delete subscriber_;
-    }
+    virtual ~ShuffleCombiner() { messages_.clear(); }
 
-    void init(int num_global_threads, int num_local_threads, int channel_id, int local_id) {
+    void init(int num_global_threads, int num_local_threads, int channel_id, int local_id,
+              ShuffleReadyRings* ready_rings) {
         num_units_ = num_global_threads;
         num_local_workers_ = num_local_threads;
         channel_id_ = channel_id;
         local_id_ = local_id;
         messages_.resize(num_units_);
-        publisher_ = channel_sc_socket_map_[channel_id][local_id_];
-        subscriber_ = channel_sc_socket_map_[channel_id][local_id_ + num_local_workers_];
+        ready_rings_ = ready_rings;
     }
 
-    void send_shuffler_buffer() { husky::zmq_send_int32(publisher_, local_id_, ZMQ_NOBLOCK); }
-
-    int access_next() {
-        int worker_id = husky::zmq_recv_int32(subscriber_);
-        return worker_id;
-    }
-
-    CollectT& storage(unsigned idx) { return messages_[idx].storage(); }
-
-    static void init_sockets(int num_local_workers, int channel_id, zmq::context_t& context) {
-        if (channel_sc_socket_map_.find(channel_id) == channel_sc_socket_map_.end()) {
-            // TODO(louis): all channels share the same set of sockets
-            std::vector<zmq::socket_t*> socket_list(2 * num_local_workers);
-            // publisher
-            std::string endpoint_prefix =
-                "inproc://shuffle_combiner_channel_" + std::to_string(channel_id) + "_worker_";
-            for (int i = 0; i < num_local_workers; i++) {
-                std::string endpoint = endpoint_prefix + std::to_string(i);
-                zmq::socket_t* pub = new zmq::socket_t(context, ZMQ_PUB);
-                ASSERT_MSG(pub != nullptr, "init_sockets: nullptr");
-                pub->bind(endpoint);
-                socket_list[i] = pub;
-            }
-            // subscriber subscribe to every other local workers except itself
-            for (int i = 0; i < num_local_workers; i++) {
-                zmq::socket_t* sub = new zmq::socket_t(context, ZMQ_SUB);
-                std::string subscribe_list = "";
-                for (int j = 0; j < num_local_workers; j++) {
-                    if (i == j)
-                        continue;
-                    std::string endpoint = endpoint_prefix + std::to_string(j);
-                    subscribe_list += endpoint + " ";
-                    sub->connect(endpoint);
-                    sub->setsockopt(ZMQ_SUBSCRIBE, "", 0);
-                }
-                socket_list[num_local_workers + i] = sub;
-            }
-            channel_sc_socket_map_[channel_id] = std::move(socket_list);
+    void send_shuffler_buffer() {
+        for (int i = 0; i < num_local_workers_; ++i) {
+            if (i != local_id_)
+                ready_rings_->push(i, local_id_);
         }
     }
 
-    static void erase_key(int channel_id) { channel_sc_socket_map_.erase(channel_id); }
+    int access_next() { return ready_rings_->pop(local_id_); }
+
+    CollectT& storage(unsigned idx) { return messages_[idx].storage(); }
 
    protected:
-    static std::unordered_map<int, std::vector<zmq::socket_t*>> channel_sc_socket_map_;
     std::vector<Shuffler<CollectT>> messages_;
     int num_units_ = 0;
     int num_local_workers_ = 0;
     int channel_id_ = -1;
     int local_id_ = -1;
-    zmq::socket_t* publisher_ = nullptr;
-    zmq::socket_t* subscriber_ = nullptr;
+    ShuffleReadyRings* ready_rings_ = nullptr;
 };
 
-template <typename CellT>
-std::unordered_map<int, std::vector<zmq::socket_t*>> ShuffleCombiner<CellT>::channel_sc_socket_map_;
 }  // namespace husky
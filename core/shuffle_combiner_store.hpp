@@ -20,7 +20,6 @@
 #include <vector>
 
 #include "core/shuffle_combiner.hpp"
-#include "core/zmq_helpers.hpp"
 
 namespace husky {
 
@@ -32,6 +31,9 @@ class ShuffleCombinerSetBase {
 template <typename KeyT, typename MsgT>
 class ShuffleCombinerSet : public ShuffleCombinerSetBase {
    public:
+    explicit ShuffleCombinerSet(size_t num_local_threads) : ready_rings(num_local_threads) {}
+
+    ShuffleReadyRings ready_rings;
     std::vector<ShuffleCombiner<std::pair<KeyT, MsgT>>> data;
 };
 
@@ -45,16 +47,13 @@ class ShuffleCombinerStore {
         // double-checked locking
         if (shuffle_combiners_map.find(channel_id) == shuffle_combiners_map.end()) {
             std::lock_guard<std::mutex> lock(shuffle_combiners_map_mutex);
-            if (shuffle_combiners_zmq_context_ptr == nullptr) {
-                shuffle_combiners_zmq_context_ptr = new zmq::context_t();
-            }
             if (shuffle_combiners_map.find(channel_id) == shuffle_combiners_map.end()) {
-                ShuffleCombinerSet<KeyT, MsgT>* shuffle_combiner_set = new ShuffleCombinerSet<KeyT, MsgT>();
+                ShuffleCombinerSet<KeyT, MsgT>* shuffle_combiner_set =
+                    new ShuffleCombinerSet<KeyT, MsgT>(num_local_threads);
                 shuffle_combiner_set->data.resize(num_local_threads);
-                ShuffleCombiner<std::pair<KeyT, MsgT>>::init_sockets(num_local_threads, channel_id,
-                                                                     *shuffle_combiners_zmq_context_ptr);
                 for (int i = 0; i < num_local_threads; i++) {
-                    shuffle_combiner_set->data[i].init(num_global_threads, num_local_threads, channel_id, i);
+                    shuffle_combiner_set->data[i].init(num_global_threads, num_local_threads, channel_id, i,
+                                                       &shuffle_combiner_set->ready_rings);
                 }
                 ShuffleCombinerStore::num_local_threads.insert(std::make_pair(channel_id, num_local_threads));
                 shuffle_combiners_map.insert(std::make_pair(channel_id, shuffle_combiner_set));
@@ -69,22 +68,16 @@ class ShuffleCombinerStore {
         std::lock_guard<std::mutex> lock(shuffle_combiners_map_mutex);
         num_local_threads[channel_id] -= 1;
         if (num_local_threads[channel_id] == 0) {
-            ShuffleCombiner<std::pair<KeyT, MsgT>>::erase_key(channel_id);
             delete shuffle_combiners_map[channel_id];
             shuffle_combiners_map.erase(channel_id);
             num_local_threads.erase(channel_id);
         }
-        if (shuffle_combiners_map.empty()) {
-            delete shuffle_combiners_zmq_context_ptr;
-            shuffle_combiners_zmq_context_ptr = nullptr;
-        }
     }
 
    protected:
     static std::unordered_map<size_t, ShuffleCombinerSetBase*> shuffle_combiners_map;
     static std::mutex shuffle_combiners_map_mutex;
     static std::unordered_map<size_t, size_t> num_local_threads;
-    static zmq::context_t* shuffle_combiners_zmq_context_ptr;
 };
 
 }  // namespace husky
@@ -9,8 +9,6 @@
 #include "boost/random.hpp"
 #include "gtest/gtest.h"
 
-#include "core/zmq_helpers.hpp"
-
 namespace husky {
 
 namespace {
@@ -30,13 +28,12 @@ TEST_F(TestShuffleCombiner, ShuffleCombiner) {
     int total_sum = 0;
     for (int i = 0; i < num_local_workers; i++)
         total_sum += i;
-    zmq::context_t context(1);
     std::atomic_int done(0);
     std::vector<ShuffleCombiner<std::pair<int, int>>> workers(num_local_workers);
     std::vector<std::thread*> threads(num_local_workers);
-    ShuffleCombiner<std::pair<int, int>>::init_sockets(num_local_workers, 0, context);
+    ShuffleReadyRings ready_rings(num_local_workers);
     for (int i = 0; i < num_local_workers; i++) {
-        workers[i].init(num_global_workers, num_local_workers, 0, i);
+        workers[i].init(num_global_workers, num_local_workers, 0, i, &ready_rings);
     }
     for (int i = 0; i < num_local_workers; i++) {
         threads[i] = new std::thread([&workers, i, max_time, &done, total_sum, num_local_workers]() {
@@ -65,7 +62,60 @@ TEST_F(TestShuffleCombiner, ShuffleCombiner) {
         i->join();
         delete i;
     }
-    ShuffleCombiner<std::pair<int, int>>::erase_key(0);
+}
+
+TEST_F(TestShuffleCombiner, ShuffleReadyRings) {
+    const int num_local_workers = 4, round = 100;
+    ShuffleReadyRings ready_rings(num_local_workers);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_local_workers; i++) {
+        threads.emplace_back([&ready_rings, i, num_local_workers, round]() {
+            std::vector<int> num_ready(num_local_workers, 0);
+            for (int r = 0; r < round; r++) {
+                for (int j = 0; j < num_local_workers; j++) {
+                    if (j != i)
+                        ready_rings.push(j, i);
+                }
+                for (int j = 0; j < num_local_workers - 1; j++)
+                    num_ready[ready_rings.pop(i)] += 1;
+            }
+            // Every peer, except itself, is ready once in each round
+            for (int j = 0; j < num_local_workers; j++)
+                EXPECT_EQ(num_ready[j], j == i ? 0 : round);
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+}
+
+TEST_F(TestShuffleCombiner, ShuffleReadyRingsSleep) {
+    // Slow peers keep the other side waiting past its spins, so it has to be woken up
+    const int num_local_workers = 2, round = 3;
+    ShuffleReadyRings ready_rings(num_local_workers);
+    std::thread popper([&ready_rings]() {
+        for (int r = 0; r < round; r++)
+            EXPECT_EQ(ready_rings.pop(0), 1);
+    });
+    for (int r = 0; r < round; r++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ready_rings.push(0, 1);
+    }
+    popper.join();
+
+    // A push into a full ring waits for its owner
+    std::atomic<int> num_pushed(0);
+    std::thread pusher([&ready_rings, &num_pushed]() {
+        for (int r = 0; r < 2 * num_local_workers + 1; r++) {
+            ready_rings.push(1, 0);
+            num_pushed += 1;
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(num_pushed, 2 * num_local_workers);
+    for (int r = 0; r < 2 * num_local_workers + 1; r++)
+        EXPECT_EQ(ready_rings.pop(1), 0);
+    pusher.join();
+    EXPECT_EQ(num_pushed, 2 * num_local_workers + 1);
 }
 
 }  // namespace
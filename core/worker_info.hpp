@@ -104,6 +104,9 @@ class WorkerInfo {
 
     inline void set_process_id(int process_id) { process_id_ = process_id; }
 
+    /// Whether objects are partitioned by consistent hashing rather than the default O(1) mapping
+    inline void set_consistent_hashing(bool consistent) { hash_ring_.set_consistent(consistent); }
+
    protected:
     std::unordered_map<int, int> global_to_proc_;
     std::vector<std::string> hostname_;
@@ -14,7 +14,9 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
+#include <utility>
 
 #include "zmq.hpp"
 
@@ -77,11 +79,46 @@ inline void zmq_sendmore_string(zmq::socket_t* socket, const std::string& data)
     zmq_send_string(socket, data, ZMQ_SNDMORE);
 }
 
+inline void zmq_send_message(zmq::socket_t* socket, zmq::message_t* msg, int flag = ZMQ_BLOCKING) {
+    ASSERT_MSG(socket != nullptr, "zmq::socket_t cannot be nullptr!");
+    while (true)
+        try {
+            bool successful = socket->send(*msg, flag);
+            ASSERT_MSG(successful, "zmq::send error!");
+            break;
+        } catch (zmq::error_t e) {
+            switch (e.num()) {
+            case EHOSTUNREACH:
+            case EINTR:
+                continue;
+            default:
+                throw base::HuskyException("Invalid type of zmq::error!");
+            }
+        }
+}
+
 // FIXME(legend): Whether it needs BinStream.get_buffer()?
 inline void zmq_send_binstream(zmq::socket_t* socket, const BinStream& stream, int flag = ZMQ_BLOCKING) {
     zmq_send_common(socket, stream.get_remained_buffer(), stream.size(), flag);
 }
 
+namespace detail {
+
+inline void free_binstream(void* data, void* hint) { delete static_cast<BinStream*>(hint); }
+
+}  // namespace detail
+
+/// Send the stream without copying it: ZMQ takes over its buffer and frees it once the message is sent
+inline void zmq_send_binstream(zmq::socket_t* socket, BinStream&& stream, int flag = ZMQ_BLOCKING) {
+    if (stream.size() == 0) {
+        zmq_send_common(socket, nullptr, 0, flag);
+        return;
+    }
+    auto* owner = new BinStream(std::move(stream));
+    zmq::message_t msg(const_cast<char*>(owner->get_remained_buffer()), owner->size(), detail::free_binstream, owner);
+    zmq_send_message(socket, &msg, flag);
+}
+
 // ZMQ receive part.
 
 inline void zmq_recv_common(zmq::socket_t* socket, zmq::message_t* msg, int flag = ZMQ_BLOCKING) {
@@ -122,12 +159,13 @@ inline std::string zmq_recv_string(zmq::socket_t* socket) {
     return std::string(reinterpret_cast<char*>(msg.data()), msg.size());
 }
 
+/// The returned stream is a read-only view of the received message, which it keeps alive
 inline BinStream zmq_recv_binstream(zmq::socket_t* socket, int flag = ZMQ_BLOCKING) {
-    zmq::message_t msg;
-    zmq_recv_common(socket, &msg, flag);
-    BinStream stream;
-    stream.push_back_bytes(reinterpret_cast<char*>(msg.data()), msg.size());
-    return stream;
+    auto msg = std::make_shared<zmq::message_t>();
+    zmq_recv_common(socket, msg.get(), flag);
+    if (msg->size() == 0)
+        return BinStream();
+    return BinStream::view(reinterpret_cast<const char*>(msg->data()), msg->size(), msg);
 }
 
 }  // namespace husky
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <thread>
+#include <utility>
 
 #include "zmq.hpp"
 
@@ -92,5 +93,34 @@ TEST_F(TestZMQHelpers, SendAndReceive) {
     delete send;
 }
 
+TEST_F(TestZMQHelpers, ZeroCopyBinStream) {
+    zmq::context_t context;
+    zmq::socket_t sender(context, ZMQ_PUSH);
+    zmq::socket_t recver(context, ZMQ_PULL);
+    recver.bind("inproc://test-zero-copy");
+    sender.connect("inproc://test-zero-copy");
+
+    BinStream input;
+    input << 1 << std::string("a") << true;
+    size_t size = input.size();
+    zmq_send_binstream(&sender, std::move(input));
+    EXPECT_EQ(input.size(), 0);
+    zmq_send_binstream(&sender, BinStream());
+
+    BinStream output = zmq_recv_binstream(&recver);
+    EXPECT_TRUE(output.is_view());
+    EXPECT_EQ(output.size(), size);
+    int out_int = 0;
+    std::string out_str;
+    bool out_bool = false;
+    output >> out_int >> out_str >> out_bool;
+    EXPECT_EQ(out_int, 1);
+    EXPECT_EQ(out_str, "a");
+    EXPECT_EQ(out_bool, true);
+
+    BinStream empty = zmq_recv_binstream(&recver);
+    EXPECT_EQ(empty.size(), 0);
+}
+
 }  // namespace
 }  // namespace husky
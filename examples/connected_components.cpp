@@ -20,6 +20,7 @@
 #include "core/engine.hpp"
 #include "io/input/inputformat_store.hpp"
 #include "lib/aggregator_factory.hpp"
+#include "lib/graph_partitioner.hpp"
 
 class Vertex {
    public:
@@ -30,14 +31,7 @@ class Vertex {
     const KeyT& id() const { return vertex_id; }
 
     // Serialization and deserialization
-    friend husky::BinStream& operator<<(husky::BinStream& stream, const Vertex& v) {
-        stream << v.vertex_id << v.adj << v.cid;
-        return stream;
-    }
-    friend husky::BinStream& operator>>(husky::BinStream& stream, Vertex& v) {
-        stream >> v.vertex_id >> v.adj >> v.cid;
-        return stream;
-    }
+    HUSKY_SERIALIZE(Vertex, vertex_id, adj, cid)
 
     int vertex_id;
     std::vector<int> adj;
@@ -65,6 +59,12 @@ void cc() {
         vertex_list.add_object(std::move(v));
     };
     husky::load(infmt, parse_wc);
+    // Place the vertices by a streaming partitioner to cut the edges between workers if partitioner=ldg/fennel
+    std::string partitioner = husky::Context::get_param("partitioner");
+    if (partitioner == "ldg" || partitioner == "fennel")
+        husky::lib::partition_graph(vertex_list, [](Vertex& v) -> const std::vector<int>& { return v.adj; },
+                                    partitioner == "ldg" ? husky::lib::StreamingHeuristic::LDG
+                                                         : husky::lib::StreamingHeuristic::Fennel);
     husky::globalize(vertex_list);
 
     auto& ch =
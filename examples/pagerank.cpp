@@ -19,6 +19,7 @@
 
 #include "core/engine.hpp"
 #include "io/input/inputformat_store.hpp"
+#include "lib/graph_partitioner.hpp"
 
 class Vertex {
    public:
@@ -29,14 +30,7 @@ class Vertex {
     const KeyT& id() const { return vertexId; }
 
     // Serialization and deserialization
-    friend husky::BinStream& operator<<(husky::BinStream& stream, const Vertex& u) {
-        stream << u.vertexId << u.adj << u.pr;
-        return stream;
-    }
-    friend husky::BinStream& operator>>(husky::BinStream& stream, Vertex& u) {
-        stream >> u.vertexId >> u.adj >> u.pr;
-        return stream;
-    }
+    HUSKY_SERIALIZE(Vertex, vertexId, adj, pr)
 
     int vertexId;
     std::vector<int> adj;
@@ -64,6 +58,12 @@ void pagerank() {
         vertex_list.add_object(std::move(v));
     };
     husky::load(infmt, parse_wc);
+    // Place the vertices by a streaming partitioner to cut the edges between workers if partitioner=ldg/fennel
+    std::string partitioner = husky::Context::get_param("partitioner");
+    if (partitioner == "ldg" || partitioner == "fennel")
+        husky::lib::partition_graph(vertex_list, [](Vertex& v) -> const std::vector<int>& { return v.adj; },
+                                    partitioner == "ldg" ? husky::lib::StreamingHeuristic::LDG
+                                                         : husky::lib::StreamingHeuristic::Fennel);
     husky::globalize(vertex_list);
 
     // Iterative PageRank computation
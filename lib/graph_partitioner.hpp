@@ -0,0 +1,218 @@
+// Copyright 2016 Husky Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "base/assert.hpp"
+#include "base/generation_lock.hpp"
+#include "core/channel/broadcast_channel.hpp"
+#include "core/engine.hpp"
+#include "core/mailbox.hpp"
+#include "core/partitioner.hpp"
+#include "core/worker_info.hpp"
+
+namespace husky {
+namespace lib {
+
+enum class StreamingHeuristic { LDG, Fennel };
+
+/// \brief Assign the vertices of a graph stream to workers by a one-pass greedy heuristic
+///
+/// Each vertex goes to the worker holding most of its already assigned neighbors, discounted by the load
+/// of the worker. LDG (Linear Deterministic Greedy) weighs the neighbor count by 1 - load / capacity, and
+/// Fennel subtracts alpha * gamma * load^(gamma - 1) from it, with gamma = 1.5 and alpha = sqrt(k) * m / n^1.5
+/// for n vertices, m edges and k workers. No worker takes more than capacity = (1 + slack) * n / k vertices
+/// unless the stream has more than n vertices. Ties go to the less loaded worker.
+template <typename KeyT>
+class StreamingGraphPartitioner {
+   public:
+    /// @param tids Global ids of the workers to assign the vertices to
+    /// @param num_vertices Number of vertices in the stream
+    /// @param num_edges Number of edges in the stream, used by Fennel
+    StreamingGraphPartitioner(std::vector<int> tids, size_t num_vertices, size_t num_edges,
+                              StreamingHeuristic heuristic = StreamingHeuristic::LDG, double slack = 0.1)
+        : tids_(std::move(tids)), heuristic_(heuristic) {
+        ASSERT_MSG(!tids_.empty(), "StreamingGraphPartitioner needs at least one worker");
+        std::sort(tids_.begin(), tids_.end());
+        tid_to_index_.resize(tids_.back() + 1, -1);
+        for (size_t i = 0; i < tids_.size(); ++i)
+            tid_to_index_[tids_[i]] = i;
+        loads_.resize(tids_.size(), 0);
+        neighbor_counts_.resize(tids_.size(), 0);
+
+        double k = tids_.size();
+        double n = std::max<size_t>(num_vertices, 1);
+        capacity_ = std::max(1.0, std::ceil((1 + slack) * n / k));
+        alpha_ = std::sqrt(k) * num_edges / std::pow(n, kGamma);
+        assignments_.reserve(num_vertices);
+    }
+
+    /// Assign a vertex given its neighbor keys
+    /// @Return the global id of the worker assigned
+    template <typename NeighborsT>
+    int assign(const KeyT& vertex, const NeighborsT& neighbors) {
+        std::fill(neighbor_counts_.begin(), neighbor_counts_.end(), 0);
+        for (const auto& neighbor : neighbors) {
+            auto iter = assignments_.find(neighbor);
+            if (iter != assignments_.end())
+                neighbor_counts_[tid_to_index_[iter->second]] += 1;
+        }
+
+        size_t best = tids_.size();
+        double best_score = 0;
+        for (size_t i = 0; i < tids_.size(); ++i) {
+            if (loads_[i] >= capacity_)
+                continue;
+            double score = heuristic_ == StreamingHeuristic::LDG
+                               ? neighbor_counts_[i] * (1 - loads_[i] / capacity_)
+                               : neighbor_counts_[i] - alpha_ * kGamma * std::pow(loads_[i], kGamma - 1);
+            if (best == tids_.size() || score > best_score || (score == best_score && loads_[i] < loads_[best])) {
+                best = i;
+                best_score = score;
+            }
+        }
+        // All workers are full since the stream outgrows num_vertices
+        if (best == tids_.size())
+            best = std::min_element(loads_.begin(), loads_.end()) - loads_.begin();
+
+        loads_[best] += 1;
+        assignments_[vertex] = tids_[best];
+        return tids_[best];
+    }
+
+    /// The global ids of the workers assigned to the vertices so far
+    inline const std::unordered_map<KeyT, int>& get_assignments() const { return assignments_; }
+
+    /// Number of vertices assigned to a worker
+    inline size_t get_load(int tid) const { return loads_[tid_to_index_[tid]]; }
+
+   protected:
+    static constexpr double kGamma = 1.5;
+
+    std::vector<int> tids_;
+    std::vector<int> tid_to_index_;
+    std::vector<double> loads_;
+    std::vector<size_t> neighbor_counts_;
+    std::unordered_map<KeyT, int> assignments_;
+    StreamingHeuristic heuristic_;
+    double capacity_;
+    double alpha_;
+};
+
+template <typename KeyT>
+constexpr double StreamingGraphPartitioner<KeyT>::kGamma;
+
+/// partition_graph() below for the worker `global_tid` (`local_tid` on its process), which exchanges the
+/// assignments through `mailbox` instead of the mailbox in the Context
+template <typename ObjT, typename AdjT>
+std::shared_ptr<TablePartitioner<typename ObjT::KeyT>> partition_graph(
+    ObjList<ObjT>& obj_list, AdjT get_adj, int local_tid, int global_tid, const WorkerInfo& worker_info,
+    LocalMailbox* mailbox, StreamingHeuristic heuristic = StreamingHeuristic::LDG, double slack = 0.1) {
+    using KeyT = typename ObjT::KeyT;
+
+    size_t num_vertices = 0, num_edges = 0;
+    for (size_t i = 0; i < obj_list.get_vector_size(); ++i) {
+        if (obj_list.get_del(i))
+            continue;
+        const auto& adj = get_adj(obj_list.get(i));
+        num_vertices += 1;
+        num_edges += std::distance(std::begin(adj), std::end(adj));
+    }
+
+    StreamingGraphPartitioner<KeyT> streaming_partitioner(worker_info.get_global_tids(), num_vertices, num_edges,
+                                                          heuristic, slack);
+    for (size_t i = 0; i < obj_list.get_vector_size(); ++i) {
+        if (obj_list.get_del(i))
+            continue;
+        auto& obj = obj_list.get(i);
+        streaming_partitioner.assign(obj.id(), get_adj(obj));
+    }
+
+    // key: global_tid
+    // value: the assignments made by the worker
+    BroadcastChannel<int, std::vector<std::pair<KeyT, int>>> broadcast_channel(&obj_list);
+    broadcast_channel.setup(local_tid, global_tid, worker_info, mailbox);
+    const auto& assignments = streaming_partitioner.get_assignments();
+    broadcast_channel.broadcast(global_tid, std::vector<std::pair<KeyT, int>>(assignments.begin(), assignments.end()));
+    broadcast_channel.flush();
+    broadcast_channel.prepare_broadcast();
+
+    // One local worker builds the table of the process, and the last one to take it releases the static handle
+    static base::CallOnceEachTime build_once;
+    static std::mutex shared_table_mutex;
+    static std::shared_ptr<TablePartitioner<KeyT>> shared_table;
+    static int num_taken = 0;
+    build_once([&]() {
+        std::shared_ptr<Partitioner<KeyT>> fallback = obj_list.get_partitioner();
+        if (fallback == nullptr)
+            fallback = std::make_shared<HashPartitioner<KeyT>>(worker_info.get_hash_ring());
+        shared_table = std::make_shared<TablePartitioner<KeyT>>(fallback);
+        auto global_tids = worker_info.get_global_tids();
+        size_t num_assignments = 0;
+        for (auto& tid : global_tids)
+            num_assignments += broadcast_channel.get(tid).size();
+        shared_table->reserve(num_assignments);
+        for (auto& tid : global_tids)
+            for (auto& kv : broadcast_channel.get(tid))
+                shared_table->set(kv.first, kv.second);
+    });
+    std::shared_ptr<TablePartitioner<KeyT>> table;
+    {
+        std::lock_guard<std::mutex> lock(shared_table_mutex);
+        table = shared_table;
+        if (++num_taken == worker_info.get_num_local_workers()) {
+            shared_table.reset();
+            num_taken = 0;
+        }
+    }
+
+    obj_list.set_partitioner(table);
+    return table;
+}
+
+/// \brief Partition the graph in obj_list by a streaming heuristic instead of hashing the vertex ids
+///
+/// Each worker streams the vertices it holds in list order, e.g., right after loading, and then the
+/// workers exchange their assignments so that every worker sets the same TablePartitioner on obj_list.
+/// A globalize() afterwards moves the vertices, and all channels to obj_list follow the table.
+///
+/// This runs k independent LDG or Fennel passes for k workers, in parallel: a worker only sees where it
+/// placed its own vertices, not the placements made by the others, and balances its own share of the
+/// graph. So the cut is better than hashing when the workers load connected parts of the graph, but worse
+/// than a single pass over the whole graph. Keys not in the table, e.g., of vertices created by messages
+/// later, fall back to the previous partitioner of obj_list, which must be the same on all workers, or to
+/// hashing. One local worker builds the table, which all the workers of the process share.
+/// It is a collective operation.
+///
+/// @param get_adj Returns the neighbor keys of a vertex (ObjT&), e.g., its adjacency list
+template <typename ObjT, typename AdjT>
+std::shared_ptr<TablePartitioner<typename ObjT::KeyT>> partition_graph(
+    ObjList<ObjT>& obj_list, AdjT get_adj, StreamingHeuristic heuristic = StreamingHeuristic::LDG,
+    double slack = 0.1) {
+    return partition_graph(obj_list, get_adj, Context::get_local_tid(), Context::get_global_tid(),
+                           Context::get_worker_info(), Context::get_mailbox(), heuristic, slack);
+}
+
+}  // namespace lib
+}  // namespace husky
@@ -0,0 +1,187 @@
+#include "lib/graph_partitioner.hpp"
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "base/serialization.hpp"
+#include "core/channel/migrate_channel.hpp"
+#include "core/mailbox.hpp"
+#include "core/objlist.hpp"
+#include "core/worker_info.hpp"
+
+namespace husky {
+namespace lib {
+namespace {
+
+class TestGraphPartitioner : public testing::Test {
+   public:
+    TestGraphPartitioner() {}
+    ~TestGraphPartitioner() {}
+
+   protected:
+    void SetUp() {}
+    void TearDown() {}
+};
+
+class Vertex {
+   public:
+    using KeyT = int;
+    KeyT key;
+    const KeyT& id() const { return key; }
+    Vertex() {}
+    explicit Vertex(const KeyT& k) : key(k) {}
+};
+
+base::BinStream& operator<<(base::BinStream& stream, const Vertex& v) { return stream << v.key; }
+base::BinStream& operator>>(base::BinStream& stream, Vertex& v) { return stream >> v.key; }
+
+// Two cliques of `size` vertices, 0 to size - 1 and size to 2 * size - 1
+std::vector<std::vector<int>> two_cliques(int size) {
+    std::vector<std::vector<int>> adj(2 * size);
+    for (int u = 0; u < 2 * size; ++u)
+        for (int v = u / size * size; v < (u / size + 1) * size; ++v)
+            if (u != v)
+                adj[u].push_back(v);
+    return adj;
+}
+
+TEST_F(TestGraphPartitioner, LDG) {
+    auto adj = two_cliques(5);
+    StreamingGraphPartitioner<int> partitioner({3, 8}, 10, 40, StreamingHeuristic::LDG);
+    for (int u = 0; u < 10; ++u)
+        partitioner.assign(u, adj[u]);
+
+    // Each clique is kept on one worker
+    auto& assignments = partitioner.get_assignments();
+    EXPECT_EQ(assignments.size(), 10);
+    for (int u = 0; u < 10; ++u)
+        EXPECT_EQ(assignments.at(u), u < 5 ? 3 : 8);
+    EXPECT_EQ(partitioner.get_load(3), 5);
+    EXPECT_EQ(partitioner.get_load(8), 5);
+}
+
+TEST_F(TestGraphPartitioner, Capacity) {
+    // A single clique cannot stay on one worker
+    std::vector<int> clique;
+    for (int u = 0; u < 12; ++u)
+        clique.push_back(u);
+    for (auto heuristic : {StreamingHeuristic::LDG, StreamingHeuristic::Fennel}) {
+        StreamingGraphPartitioner<int> partitioner({0, 1, 2}, 12, 132, heuristic, 0.25);
+        for (int u = 0; u < 12; ++u)
+            partitioner.assign(u, clique);
+        for (int tid = 0; tid < 3; ++tid)
+            EXPECT_LE(partitioner.get_load(tid), 5);
+    }
+
+    // Vertices beyond the expected number go to the least loaded worker
+    StreamingGraphPartitioner<int> partitioner({0, 1}, 2, 0, StreamingHeuristic::LDG, 0);
+    partitioner.assign(0, clique);
+    partitioner.assign(1, clique);
+    partitioner.assign(2, clique);
+    partitioner.assign(3, clique);
+    EXPECT_EQ(partitioner.get_load(0), 2);
+    EXPECT_EQ(partitioner.get_load(1), 2);
+}
+
+TEST_F(TestGraphPartitioner, Fennel) {
+    auto adj = two_cliques(20);
+    StreamingGraphPartitioner<int> partitioner({0, 1}, 40, 760 / 2, StreamingHeuristic::Fennel);
+    int cut = 0;
+    for (int u = 0; u < 40; ++u)
+        partitioner.assign(u, adj[u]);
+    auto& assignments = partitioner.get_assignments();
+    for (int u = 0; u < 40; ++u)
+        for (int v : adj[u])
+            cut += assignments.at(u) != assignments.at(v);
+    // Hashing would cut about half of the 760 edges
+    EXPECT_LT(cut, 760 / 4);
+    EXPECT_LE(partitioner.get_load(0), 22);
+    EXPECT_LE(partitioner.get_load(1), 22);
+}
+
+TEST_F(TestGraphPartitioner, PartitionAndMigrate) {
+    // Four workers on one process, each loading halves of two of the four cliques of 16 vertices
+    const int kNumWorkers = 4, kNumCliques = 4, kCliqueSize = 16;
+    std::vector<std::vector<int>> adj(kNumCliques * kCliqueSize);
+    for (int u = 0; u < adj.size(); ++u)
+        for (int v = u / kCliqueSize * kCliqueSize; v < (u / kCliqueSize + 1) * kCliqueSize; ++v)
+            if (u != v)
+                adj[u].push_back(v);
+
+    // Mailbox Setup
+    zmq::context_t zmq_context;
+    MailboxEventLoop el(&zmq_context);
+    el.set_process_id(0);
+    CentralRecver recver(&zmq_context, "inproc://test-graph-partitioner");
+    std::vector<std::unique_ptr<LocalMailbox>> mailboxes;
+    for (int tid = 0; tid < kNumWorkers; ++tid) {
+        mailboxes.emplace_back(new LocalMailbox(&zmq_context));
+        mailboxes[tid]->set_thread_id(tid);
+        el.register_mailbox(*mailboxes[tid]);
+    }
+
+    // WorkerInfo Setup
+    WorkerInfo workerinfo;
+    for (int tid = 0; tid < kNumWorkers; ++tid)
+        workerinfo.add_worker(0, tid, tid);
+    workerinfo.set_process_id(0);
+
+    std::mutex mutex;
+    std::vector<int> placements(adj.size(), -1);
+    std::set<const TablePartitioner<int>*> tables;
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < kNumWorkers; ++tid) {
+        threads.emplace_back([&, tid]() {
+            ObjList<Vertex> vertices;
+            for (int u = 0; u < adj.size(); ++u)
+                if (u / (kCliqueSize / 2) % kNumWorkers == tid)
+                    vertices.add_object(Vertex(u));
+            vertices.sort();
+
+            auto table = partition_graph(vertices, [&](Vertex& v) -> const std::vector<int>& { return adj[v.id()]; },
+                                         tid, tid, workerinfo, mailboxes[tid].get());
+
+            // Move the vertices as globalize() does
+            MigrateChannel<Vertex> migrate_channel(&vertices, &vertices);
+            migrate_channel.setup(tid, tid, workerinfo, mailboxes[tid].get());
+            for (auto& v : vertices.get_data()) {
+                int dst = vertices.lookup_partition(v.id(), workerinfo.get_hash_ring());
+                if (dst != tid)
+                    migrate_channel.migrate(v, dst);
+            }
+            vertices.deletion_finalize();
+            migrate_channel.flush();
+            migrate_channel.prepare_immigrants();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            tables.insert(table.get());
+            for (auto& v : vertices.get_data())
+                placements[v.id()] = tid;
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    // The workers share one table, and the vertices move to the workers in it
+    EXPECT_EQ(tables.size(), 1);
+    int cut = 0, hash_cut = 0;
+    const auto& hash_ring = workerinfo.get_hash_ring();
+    for (int u = 0; u < adj.size(); ++u) {
+        ASSERT_NE(placements[u], -1);
+        for (int v : adj[u]) {
+            cut += placements[u] != placements[v];
+            hash_cut += hash_ring.hash_lookup(u) != hash_ring.hash_lookup(v);
+        }
+    }
+    // Each worker only sees its own placements, so the cliques are not kept whole, but the cut beats hashing
+    EXPECT_LT(cut, hash_cut * 3 / 4);
+}
+
+}  // namespace
+}  // namespace lib
+}  // namespace husky
@@ -0,0 +1,22 @@
+# Distributed under the OSI-approved BSD 3-Clause License.  See accompanying
+# file Copyright.txt or https://cmake.org/licensing for details.
+
+cmake_minimum_required(VERSION 3.5)
+
+file(MAKE_DIRECTORY
+  "/root/repo/third_party/src/gtest"
+  "/root/repo/third_party/src/gtest-build"
+  "/root/repo/third_party"
+  "/root/repo/third_party/tmp"
+  "/root/repo/third_party/src/gtest-stamp"
+  "/root/repo/third_party/src"
+  "/root/repo/third_party/src/gtest-stamp"
+)
+
+set(configSubDirs )
+foreach(subDir IN LISTS configSubDirs)
+    file(MAKE_DIRECTORY "/root/repo/third_party/src/gtest-stamp/${subDir}")
+endforeach()
+if(cfgdir)
+  file(MAKE_DIRECTORY "/root/repo/third_party/src/gtest-stamp${cfgdir}") # cfgdir has leading slash
+endif()